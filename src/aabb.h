@@ -0,0 +1,105 @@
+/***********************************************************************************
+*   aabb.h   , 
+*    (axis-aligned bounding box).
+*
+*     x, y, z.   , 
+*   t,        
+*  ("", slabs),   .   x: x = Ax + tbx, 
+* t0 = (x0 - Ax)/bx  t1 = (x1 - Ax)/bx.  bx = 0,   +/-INF, 
+*   .
+*
+*         
+* ,       (bvh.h)
+*     .
+***********************************************************************************/
+
+#ifndef AABB_H
+#define AABB_H
+
+class aabb
+{
+public:
+	interval x, y, z;
+	static const aabb empty, universe;
+
+	aabb() {} //    ,    .
+	aabb(const interval& x, const interval& y, const interval& z) : x(x), y(y), z(z) { pad_to_minimums(); }
+
+	//  a  b     .
+	aabb(const point3& a, const point3& b)
+	{
+		x = (a[0] <= b[0]) ? interval(a[0], b[0]) : interval(b[0], a[0]);
+		y = (a[1] <= b[1]) ? interval(a[1], b[1]) : interval(b[1], a[1]);
+		z = (a[2] <= b[2]) ? interval(a[2], b[2]) : interval(b[2], a[2]);
+		pad_to_minimums();
+	}
+
+	// ,   .
+	aabb(const aabb& box0, const aabb& box1)
+		: x(box0.x, box1.x), y(box0.y, box1.y), z(box0.z, box1.z) {}
+
+	const interval& axis_interval(int n) const
+	{
+		if (n == 1) { return y; }
+		if (n == 2) { return z; }
+		return x;
+	}
+
+	point3 centroid() const { return point3(0.5*(x.min + x.max), 0.5*(y.min + y.max), 0.5*(z.min + z.max)); }
+
+	//     .
+	int longest_axis() const
+	{
+		if (x.size() > y.size()) { return x.size() > z.size() ? 0 : 2; }
+		return y.size() > z.size() ? 1 : 2;
+	}
+
+	//   -      (. SAH  bvh.h).
+	real surface_area() const
+	{
+		if (x.size() < 0 || y.size() < 0 || z.size() < 0) { return 0; }
+		return 2 * (x.size()*y.size() + y.size()*z.size() + z.size()*x.size());
+	}
+
+	bool hit(const ray& r, interval ray_t) const
+	{
+		const point3& orig = r.origin();
+		const vec3&   dir  = r.direction();
+
+		for (int axis = 0; axis < 3; ++axis) {
+			const interval& ax = axis_interval(axis);
+			const real adinv = 1 / dir[axis];
+
+			real t0 = (ax.min - orig[axis]) * adinv;
+			real t1 = (ax.max - orig[axis]) * adinv;
+
+			if (t0 < t1) {
+				if (t0 > ray_t.min) { ray_t.min = t0; }
+				if (t1 < ray_t.max) { ray_t.max = t1; }
+			}
+			else {
+				if (t1 > ray_t.min) { ray_t.min = t1; }
+				if (t0 < ray_t.max) { ray_t.max = t0; }
+			}
+
+			if (ray_t.max <= ray_t.min) { return false; }
+		}
+		return true;
+	}
+
+private:
+	//    (,   )   
+	// "" - ,     .
+	void pad_to_minimums()
+	{
+		real delta = real(0.0001);
+		if (x.size() < delta) { x = x.expand(delta); }
+		if (y.size() < delta) { y = y.expand(delta); }
+		if (z.size() < delta) { z = z.expand(delta); }
+	}
+};
+
+const aabb aabb::empty    = aabb(interval::empty,    interval::empty,    interval::empty);
+const aabb aabb::universe = aabb(interval::universe, interval::universe, interval::universe);
+
+#endif
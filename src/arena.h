@@ -0,0 +1,184 @@
+/***********************************************************************************
+*   arena.h    scene_arena - 
+* " " (bump allocator)  ,    :
+*    (bvh.h)     (camera.h).
+*
+*     ,   ( BLOCK_SIZE, 
+*    ,   MAX_BLOCK_SIZE).  - 
+*    ,   ,    ,
+*  ,  ,        .
+*    : release()   , reset()
+*  ,       (
+*         ).
+*
+*  ,   ,   ,  ;
+*        .   : 
+*     (  - thread_local).
+***********************************************************************************/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class scene_arena
+{
+private:
+	struct block
+	{
+		char*  data;
+		size_t size;
+	};
+
+	/*    ;         */
+	struct finalizer
+	{
+		void     (*destroy)(void*);
+		void*      object;
+		finalizer* next;
+	};
+
+	std::vector<block> blocks;
+	size_t     current   = 0;	//   
+	size_t     offset    = 0;	//    
+	size_t     used      = 0;	//     reset(),   
+	finalizer* finalizers = nullptr;
+
+	/*    ,  size ,    */
+	void next_block(size_t size, size_t alignment)
+	{
+		size_t needed = size + alignment;
+		for (size_t k = blocks.empty() ? 0 : current + 1; k < blocks.size(); ++k) {
+			if (blocks[k].size >= needed) {
+				std::swap(blocks[k], blocks[current + 1]);
+				current = current + 1;
+				offset  = 0;
+				return;
+			}
+		}
+		size_t grow = blocks.empty() ? BLOCK_SIZE : std::min(blocks.back().size * 2, MAX_BLOCK_SIZE);
+		block b = { static_cast<char*>(::operator new(std::max(grow, needed), std::align_val_t(CACHE_LINE))), std::max(grow, needed) };
+		if (blocks.empty()) { blocks.push_back(b); current = 0; }
+		else {
+			blocks.insert(blocks.begin() + std::ptrdiff_t(current + 1), b);
+			current = current + 1;
+		}
+		offset = 0;
+	}
+
+	void run_finalizers()
+	{
+		for (finalizer* f = finalizers; f; f = f->next) { f->destroy(f->object); }
+		finalizers = nullptr;
+	}
+
+public:
+	static const size_t CACHE_LINE     = 64;
+	static const size_t BLOCK_SIZE     = size_t(64) << 10;
+	static const size_t MAX_BLOCK_SIZE = size_t(16) << 20;
+
+	scene_arena() {}
+	scene_arena(const scene_arena&) = delete;
+	scene_arena& operator=(const scene_arena&) = delete;
+
+	scene_arena(scene_arena&& other) noexcept
+		: blocks(std::move(other.blocks)), current(other.current), offset(other.offset), used(other.used), finalizers(other.finalizers)
+	{
+		other.blocks.clear();
+		other.current = other.offset = other.used = 0;
+		other.finalizers = nullptr;
+	}
+
+	scene_arena& operator=(scene_arena&& other) noexcept
+	{
+		if (this != &other) {
+			release();
+			blocks = std::move(other.blocks);
+			current = other.current; offset = other.offset; used = other.used; finalizers = other.finalizers;
+			other.blocks.clear();
+			other.current = other.offset = other.used = 0;
+			other.finalizers = nullptr;
+		}
+		return *this;
+	}
+
+	~scene_arena() { release(); }
+
+	/* size    alignment ( ,   CACHE_LINE) */
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		size_t start = blocks.empty() ? 0 : (offset + alignment - 1) & ~(alignment - 1);
+		if (blocks.empty() || start + size > blocks[current].size) {
+			next_block(size, alignment);
+			start = 0;
+		}
+		used  += start - offset + size;
+		offset = start + size;
+		return blocks[current].data + start;
+	}
+
+	/*   ,    (placement new) */
+	template <typename T>
+	void add_finalizer(T* object)
+	{
+		if (std::is_trivially_destructible<T>::value) { return; }
+		finalizer* f = static_cast<finalizer*>(allocate(sizeof(finalizer), alignof(finalizer)));
+		f->destroy = [](void* p) { static_cast<T*>(p)->~T(); };
+		f->object  = object;
+		f->next    = finalizers;
+		finalizers = f;
+	}
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args)
+	{
+		T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		add_finalizer(object);
+		return object;
+	}
+
+	/*   count ,     */
+	template <typename T>
+	T* create_array(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "arena arrays do not run destructors");
+		T* objects = static_cast<T*>(allocate(sizeof(T) * std::max<size_t>(count, 1), alignof(T)));
+		for (size_t k = 0; k < count; ++k) { new (objects + k) T(); }
+		return objects;
+	}
+
+	/*        ,     */
+	void reset()
+	{
+		run_finalizers();
+		current = 0;
+		offset  = 0;
+		used    = 0;
+	}
+
+	/*       */
+	void release()
+	{
+		run_finalizers();
+		for (const block& b : blocks) { ::operator delete(b.data, std::align_val_t(CACHE_LINE)); }
+		blocks.clear();
+		current = offset = used = 0;
+	}
+
+	size_t bytes_used() const { return used; }
+	size_t block_count() const { return blocks.size(); }
+
+	size_t bytes_reserved() const
+	{
+		size_t total = 0;
+		for (const block& b : blocks) { total += b.size; }
+		return total;
+	}
+};
+
+#endif
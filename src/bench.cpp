@@ -0,0 +1,400 @@
+﻿/***********************************************************************************
+* Программа ray-tracing-bench выполняет замеры производительности визуализации на
+* наборе сцен, построенных из фиксированного начального значения (см. scene.h), и
+* выводит результаты в формате JSON для сравнения сборок между собой.
+*
+* Сцены:
+* > random_spheres_N - сцена main.cpp (scenes/cover.txt) с сеткой (2N)^2 маленьких сфер;
+* > glass_spheres_11 - та же сетка, все сферы стеклянные (длинные пути преломления);
+* > lit_spheres_5    - сетка random_spheres_5, освещенная тремя маленькими источниками
+*                      (прямое освещение и теневые лучи, см. light.h);
+* > single_sphere    - одна диффузная сфера (базовая стоимость камеры и планировщика);
+* > mesh_sphere_512  - сфера из ~1 млн треугольников (triangle_mesh.h): построение
+*                      иерархии сетки входит в фазу scene, обход - в render;
+* > instanced_meshes_22 - 44^2 экземпляров (instance.h) объекта из сферы в ~65 тыс.
+*                      треугольников: в памяти одна сетка, BVH сцены строится над
+*                      экземплярами (поле instanced_triangles - видимые треугольники).
+*
+* Для каждой сцены измеряется время по настенным часам (steady_clock) каждой фазы:
+* построение сцены, построение BVH (wide_bvh, как в main.cpp) и визуализация (лучшее и медиана из --repeat
+* повторов). По статистике камеры (render_stats) вычисляются сэмплы в секунду и
+* лучи в секунду (Mrays/s - все трассированные сегменты путей).
+*
+* Раздел sampling_ns - время генерации направлений и точек круга методом отбрасывания
+* и явными преобразованиями (bench_sampling() в benchmark.h).
+*
+* Раздел vec3_ops - время операций vec3 (bench_vec3_ops() в benchmark.h). Вместе с
+* полями build.real и build.vec3 он позволяет сравнить сборки с разным
+* представлением векторов (RT_FLOAT, RT_SIMD_VEC3) на одних и тех же сценах.
+*
+* С ключом --convergence дополнительно строятся кривые сходимости сэмплеров (раздел
+* convergence, bench_convergence() в benchmark.h): RMSE изображения random_spheres_11
+* по отношению к эталону с --reference-spp сэмплами при 1, 4, 16 и 64 сэмплах на
+* пиксель для независимых, стратифицированных сэмплов и последовательности Соболя.
+*
+* С ключом --layout дополнительно сравниваются размещения узлов BVH (раздел
+* bvh_layout, bench_bvh_layout() в benchmark.h): узлы в куче с управляющими блоками
+* shared_ptr и узлы подряд в области scene_arena (arena.h) на сценах random_spheres_44
+* и random_spheres_176 (~124 тыс. сфер) - время построения, память и число выделений
+* памяти, лучи в секунду и промахи кэша при трассировке (null - счетчик недоступен).
+*
+* С ключом --traversal дополнительно сравниваются иерархии (раздел bvh_traversal,
+* bench_bvh_traversal() в benchmark.h): bvh_node, плоская flat_bvh и четырехарная
+* wide_bvh на сцене random_spheres_500 (1 млн сфер) - время построения, число узлов,
+* глубина и память узлов, лучи в секунду для hit() и для отрезков hit()/occluded().
+*
+* С ключом --build дополнительно сравниваются способы построения (раздел bvh_build,
+* bench_bvh_build() в benchmark.h) на той же сцене random_spheres_500: SAH и LBVH
+* в одном потоке и на --threads потоках, а после сдвига сфер - обновление дерева
+* (refit) и перестройка; для каждого - время, стоимость SAH и лучи в секунду.
+*
+* ray-tracing-bench [--width N] [--spp N] [--depth N] [--repeat N] [--threads N]
+*                   [--scene substring] [--convergence [--reference-spp N]] [--layout]
+*                   [--traversal] [--build] [-o file.json]
+* > --scene  замерять только сцены, имя которых содержит подстроку;
+* > -o       файл результатов (по умолчанию стандартный поток вывода).
+***********************************************************************************/
+
+#include "rt_settings.h"
+#include "bvh.h"
+#include "wide_bvh.h"
+#include "camera.h"
+#include "scene.h"
+#include "benchmark.h"
+#include "scheduler.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__VERSION__)
+	#define RT_COMPILER __VERSION__
+#elif defined(_MSC_FULL_VER)
+	#define RT_COMPILER "MSVC " RT_STRINGIFY(_MSC_FULL_VER)
+	#define RT_STRINGIFY(x) RT_STRINGIFY_(x)
+	#define RT_STRINGIFY_(x) #x
+#else
+	#define RT_COMPILER "unknown"
+#endif
+
+/* Результаты замера одной сцены */
+struct scene_result
+{
+	std::string name;
+	size_t      objects   = 0;
+	size_t      triangles = 0;
+	size_t      instances = 0;
+	size_t      instanced_triangles = 0;
+	size_t      materials = 0;
+	double      scene_ms  = 0;	// построение сцены
+	double      bvh_ms    = 0;	// построение BVH
+	std::vector<double> render_s;	// время каждого повтора визуализации
+	render_stats stats;			// статистика последнего повтора
+
+	double best()   const { return *std::min_element(render_s.begin(), render_s.end()); }
+	double median() const
+	{
+		std::vector<double> sorted = render_s;
+		std::sort(sorted.begin(), sorted.end());
+		return sorted[sorted.size() / 2];
+	}
+};
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* Замер bench_bvh_layout() обоих размещений на одной сцене */
+struct layout_comparison
+{
+	std::string   name;
+	size_t        objects = 0;
+	layout_result heap, arena;
+};
+
+static void write_layout(std::ostream& out, const char* name, const layout_result& r)
+{
+	out << "\"" << name << "\": { \"build_ms\": " << r.build_ms << ", \"release_ms\": " << r.release_ms
+		<< ", \"nodes\": " << r.nodes << ", \"heap_bytes\": " << r.heap_bytes
+		<< ", \"allocations\": " << r.allocations << ", \"mrays_per_s\": " << r.trace.rays_per_second() / 1e6 << ", \"cache_misses\": ";
+	if (r.cache_misses < 0) { out << "null"; } else { out << r.cache_misses; }
+	out << " }";
+}
+
+/* Замер bench_bvh_build() всех способов построения на одной сцене */
+struct build_comparison
+{
+	std::string name;
+	size_t      objects = 0;
+	std::vector<build_result> modes;
+};
+
+/* Замер bench_bvh_traversal() всех иерархий на одной сцене */
+struct traversal_comparison
+{
+	std::string name;
+	size_t      objects = 0;
+	std::vector<traversal_result> trees;
+};
+
+static void write_json(std::ostream& out, const std::vector<scene_result>& results, const vec3_ops_result& ops,
+					   const sampling_result& sampling, const std::vector<convergence_point>& convergence,
+					   const std::vector<layout_comparison>& layouts, const std::vector<traversal_comparison>& traversals,
+					   const std::vector<build_comparison>& builds, const camera& settings, int repeat)
+{
+	out << "{\n";
+	out << "  \"build\": { \"compiler\": \"" << RT_COMPILER << "\", \"simd\": \"" << simd_level_name(detect_simd_level())
+		<< "\", \"real\": \"" << (sizeof(real) == sizeof(float) ? "float" : "double")
+		<< "\", \"vec3\": \"" << (vec3_lanes<real>::enabled ? "simd" : "scalar")
+#ifdef NDEBUG
+		<< "\", \"assertions\": false"
+#else
+		<< "\", \"assertions\": true"
+#endif
+		<< ", \"threads\": " << resolve_thread_count(settings.THREADS) << " },\n";
+	out << "  \"settings\": { \"width\": " << settings.IMAGE_WIDTH << ", \"spp\": " << settings.SAMPLES_PER_PIXEL
+		<< ", \"max_depth\": " << settings.MAX_DEPTH << ", \"repeat\": " << repeat << " },\n";
+	out << "  \"vec3_ops_ns\": { \"add\": " << ops.add_ns << ", \"dot\": " << ops.dot_ns << ", \"cross\": " << ops.cross_ns
+		<< ", \"length\": " << ops.length_ns << ", \"unitv\": " << ops.unitv_ns << " },\n";
+	out << "  \"sampling_ns\": { \"rejection_sphere\": " << sampling.rejection_sphere_ns << ", \"warp_sphere\": " << sampling.warp_sphere_ns
+		<< ", \"rejection_disk\": " << sampling.rejection_disk_ns << ", \"warp_disk\": " << sampling.warp_disk_ns
+		<< ", \"batch_sphere\": " << sampling.batch_sphere_ns << ", \"batch_cosine\": " << sampling.batch_cosine_ns
+		<< ", \"batch_disk\": " << sampling.batch_disk_ns << " },\n";
+	out << "  \"scenes\": [\n";
+	for (size_t k = 0; k < results.size(); ++k) {
+		const scene_result& r = results[k];
+		double best = r.best();
+		out << "    {\n";
+		out << "      \"name\": \"" << r.name << "\", \"objects\": " << r.objects << ", \"triangles\": " << r.triangles << ", \"materials\": " << r.materials << ",\n";
+		out << "      \"instances\": " << r.instances << ", \"instanced_triangles\": " << r.instanced_triangles << ",\n";
+		out << "      \"phases_ms\": { \"scene\": " << r.scene_ms << ", \"bvh\": " << r.bvh_ms
+			<< ", \"render\": " << best * 1e3 << " },\n";
+		out << "      \"render\": { \"wall_s_best\": " << best << ", \"wall_s_median\": " << r.median()
+			<< ", \"samples\": " << r.stats.paths << ", \"rays\": " << r.stats.segments << ", \"shadow_rays\": " << r.stats.shadow
+			<< ", \"samples_per_s\": " << r.stats.paths / best << ", \"mrays_per_s\": " << r.stats.segments / best / 1e6
+			<< ", \"avg_path_length\": " << r.stats.average_path_length() << " }\n";
+		out << "    }" << (k + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]";
+	if (!convergence.empty()) {
+		out << ",\n  \"convergence\": [\n";
+		for (size_t k = 0; k < convergence.size(); ++k) {
+			const convergence_point& p = convergence[k];
+			out << "    { \"sampler\": \"" << sampler_type_name(p.type) << "\", \"spp\": " << p.spp << ", \"rmse\": " << p.rmse
+				<< ", \"seconds\": " << p.seconds << " }" << (k + 1 < convergence.size() ? "," : "") << "\n";
+		}
+		out << "  ]";
+	}
+	if (!layouts.empty()) {
+		out << ",\n  \"bvh_layout\": [\n";
+		for (size_t k = 0; k < layouts.size(); ++k) {
+			const layout_comparison& l = layouts[k];
+			out << "    { \"scene\": \"" << l.name << "\", \"objects\": " << l.objects << ",\n      ";
+			write_layout(out, "heap", l.heap);
+			out << ",\n      ";
+			write_layout(out, "arena", l.arena);
+			out << " }" << (k + 1 < layouts.size() ? "," : "") << "\n";
+		}
+		out << "  ]";
+	}
+	if (!traversals.empty()) {
+		out << ",\n  \"bvh_traversal\": [\n";
+		for (size_t k = 0; k < traversals.size(); ++k) {
+			const traversal_comparison& c = traversals[k];
+			out << "    { \"scene\": \"" << c.name << "\", \"objects\": " << c.objects << ", \"trees\": [\n";
+			for (size_t j = 0; j < c.trees.size(); ++j) {
+				const traversal_result& t = c.trees[j];
+				out << "      { \"name\": \"" << t.name << "\", \"build_ms\": " << t.stats.build_ms << ", \"nodes\": " << t.stats.nodes
+					<< ", \"depth\": " << t.stats.max_depth << ", \"node_bytes\": " << t.node_bytes
+					<< ", \"mrays_per_s\": " << t.trace.rays_per_second() / 1e6
+					<< ", \"segment_hit_mrays_per_s\": " << t.visibility.hit.rays_per_second() / 1e6
+					<< ", \"segment_occluded_mrays_per_s\": " << t.visibility.occluded.rays_per_second() / 1e6
+					<< " }" << (j + 1 < c.trees.size() ? "," : "") << "\n";
+			}
+			out << "    ] }" << (k + 1 < traversals.size() ? "," : "") << "\n";
+		}
+		out << "  ]";
+	}
+	if (!builds.empty()) {
+		out << ",\n  \"bvh_build\": [\n";
+		for (size_t k = 0; k < builds.size(); ++k) {
+			const build_comparison& c = builds[k];
+			out << "    { \"scene\": \"" << c.name << "\", \"objects\": " << c.objects << ", \"modes\": [\n";
+			for (size_t j = 0; j < c.modes.size(); ++j) {
+				const build_result& b = c.modes[j];
+				out << "      { \"mode\": \"" << b.mode << "\", \"threads\": " << b.threads << ", \"build_ms\": " << b.stats.build_ms
+					<< ", \"nodes\": " << b.stats.nodes << ", \"depth\": " << b.stats.max_depth << ", \"sah_cost\": " << b.stats.sah_cost
+					<< ", \"mrays_per_s\": " << b.trace.rays_per_second() / 1e6 << " }" << (j + 1 < c.modes.size() ? "," : "") << "\n";
+			}
+			out << "    ] }" << (k + 1 < builds.size() ? "," : "") << "\n";
+		}
+		out << "  ]";
+	}
+	out << "\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+	std::ios_base::sync_with_stdio(0);
+
+	camera settings;
+	settings.IMAGE_WIDTH = 400;
+	settings.SAMPLES_PER_PIXEL = 16;
+	settings.MAX_DEPTH = 50;
+	int         repeat = 3;
+	bool        convergence = false;
+	bool        layout = false;
+	bool        traversal = false;
+	bool        build = false;
+	int         reference_spp = 1024;
+	std::string filter, output_path;
+	for (int k = 1; k < argc; ++k) {
+		if (std::strcmp(argv[k], "--width") == 0 && k + 1 < argc) { settings.IMAGE_WIDTH = std::atoi(argv[++k]); }
+		else if (std::strcmp(argv[k], "--spp") == 0 && k + 1 < argc) { settings.SAMPLES_PER_PIXEL = std::atoi(argv[++k]); }
+		else if (std::strcmp(argv[k], "--depth") == 0 && k + 1 < argc) { settings.MAX_DEPTH = std::atoi(argv[++k]); }
+		else if (std::strcmp(argv[k], "--repeat") == 0 && k + 1 < argc) { repeat = std::max(1, std::atoi(argv[++k])); }
+		else if (std::strcmp(argv[k], "--threads") == 0 && k + 1 < argc) { settings.THREADS = std::atoi(argv[++k]); }
+		else if (std::strcmp(argv[k], "--scene") == 0 && k + 1 < argc) { filter = argv[++k]; }
+		else if (std::strcmp(argv[k], "--convergence") == 0) { convergence = true; }
+		else if (std::strcmp(argv[k], "--layout") == 0) { layout = true; }
+		else if (std::strcmp(argv[k], "--traversal") == 0) { traversal = true; }
+		else if (std::strcmp(argv[k], "--build") == 0) { build = true; }
+		else if (std::strcmp(argv[k], "--reference-spp") == 0 && k + 1 < argc) { reference_spp = std::max(1, std::atoi(argv[++k])); }
+		else if (std::strcmp(argv[k], "-o") == 0 && k + 1 < argc) { output_path = argv[++k]; }
+		else { std::cerr << "Unknown argument: " << argv[k] << '\n'; return 1; }
+	}
+
+	struct bench_scene
+	{
+		std::string            name;
+		std::function<scene()> make;
+	};
+	const std::vector<bench_scene> scenes = {
+		{ "random_spheres_5",  []() { return scene::random_spheres(5, 2024); } },
+		{ "random_spheres_11", []() { return scene::random_spheres(11, 2024); } },
+		{ "random_spheres_22", []() { return scene::random_spheres(22, 2024); } },
+		{ "random_spheres_44", []() { return scene::random_spheres(44, 2024); } },
+		{ "glass_spheres_11",  []() { return scene::glass_spheres(11, 2024); } },
+		{ "lit_spheres_5",     []() { return scene::lit_spheres(5, 2024); } },
+		{ "single_sphere",     []() { return scene::single_sphere(); } },
+		{ "mesh_sphere_512",   []() { return scene::mesh_sphere(512); } },
+		{ "instanced_meshes_22", []() { return scene::instanced_meshes(22, 128, 2024); } },
+	};
+
+	vec3_ops_result ops = bench_vec3_ops();
+	sampling_result sampling = bench_sampling();
+
+	std::vector<scene_result> results;
+	for (const bench_scene& entry : scenes) {
+		if (!filter.empty() && entry.name.find(filter) == std::string::npos) { continue; }
+		std::clog << entry.name << '\n';
+
+		scene_result res;
+		res.name = entry.name;
+
+		auto start = std::chrono::steady_clock::now();
+		scene sc = entry.make();
+		res.scene_ms = elapsed_ms(start);
+		res.objects = sc.spheres.size() + sc.meshes.size() + sc.instances.size();
+		res.triangles = sc.triangle_count();
+		res.instances = sc.instances.size();
+		res.instanced_triangles = sc.instanced_triangle_count();
+		res.materials = sc.materials.size();
+
+		bvh_stats     bvh_info;
+		hittable_list world(make_shared<wide_bvh>(sc.world(), &bvh_info));
+		light_list    lights(sc.world(), sc.materials);
+		res.bvh_ms = bvh_info.build_ms;
+
+		/* параметры кадра из настроек замера, положение камеры - из сцены */
+		camera cam = sc.cam;
+		cam.IMAGE_WIDTH       = settings.IMAGE_WIDTH;
+		cam.SAMPLES_PER_PIXEL = settings.SAMPLES_PER_PIXEL;
+		cam.MAX_DEPTH         = settings.MAX_DEPTH;
+		cam.THREADS           = settings.THREADS;
+		for (int k = 0; k < repeat; ++k) {
+			start = std::chrono::steady_clock::now();
+			cam.render_frame(world, sc.materials, &lights);
+			res.render_s.push_back(elapsed_ms(start) / 1e3);
+		}
+		res.stats = cam.stats();
+		results.push_back(res);
+	}
+
+	std::vector<convergence_point> curves;
+	if (convergence) {
+		std::clog << "convergence\n";
+		scene sc = scene::random_spheres(11, 2024);
+		hittable_list world(make_shared<bvh_node>(sc.world()));
+		camera cam = sc.cam;
+		cam.IMAGE_WIDTH = settings.IMAGE_WIDTH;
+		cam.MAX_DEPTH   = settings.MAX_DEPTH;
+		cam.THREADS     = settings.THREADS;
+		curves = bench_convergence(cam, world, sc.materials, { 1, 4, 16, 64 }, reference_spp);
+	}
+
+	std::vector<layout_comparison> layouts;
+	if (layout) {
+		for (int half_grid : { 44, 176 }) {
+			layout_comparison l;
+			l.name = "random_spheres_" + std::to_string(half_grid);
+			std::clog << "layout " << l.name << '\n';
+			scene sc = scene::random_spheres(half_grid, 2024);
+			hittable_list objects = sc.world();
+			l.objects = objects.objects.size();
+			std::vector<ray> rays = make_benchmark_rays(sc.cam.LOOKFROM, objects.bounding_box(), 200000, 1);
+			l.heap  = bench_bvh_layout(objects, rays, false, repeat);
+			l.arena = bench_bvh_layout(objects, rays, true, repeat);
+			layouts.push_back(l);
+		}
+	}
+
+	std::vector<traversal_comparison> traversals;
+	if (traversal) {
+		traversal_comparison c;
+		c.name = "random_spheres_500";
+		std::clog << "traversal " << c.name << '\n';
+		scene sc = scene::random_spheres(500, 2024);
+		hittable_list objects = sc.world();
+		c.objects = objects.objects.size();
+		std::vector<ray> rays = make_benchmark_rays(sc.cam.LOOKFROM, objects.bounding_box(), 200000, 1);
+		c.trees = bench_bvh_traversal(objects, rays, repeat);
+		traversals.push_back(c);
+	}
+
+	std::vector<build_comparison> builds;
+	if (build) {
+		build_comparison c;
+		c.name = "random_spheres_500";
+		std::clog << "build " << c.name << '\n';
+		scene sc = scene::random_spheres(500, 2024);
+		hittable_list objects = sc.world();
+		c.objects = objects.objects.size();
+		std::vector<ray> rays = make_benchmark_rays(sc.cam.LOOKFROM, objects.bounding_box(), 200000, 1);
+		auto animate = [&sc]() { // сферы сетки сдвигаются не больше чем на половину шага сетки
+			rng gen(3);
+			for (size_t k = 1; k < sc.spheres.size(); ++k) {
+				const sphere& s = sc.spheres[k];
+				vec3 offset(gen.next_double() - 0.5, 0.5 * gen.next_double(), gen.next_double() - 0.5);
+				sc.spheres[k] = sphere(s.get_center() + offset, s.get_radius(), s.get_material());
+			}
+		};
+		c.modes = bench_bvh_build(objects, rays, settings.THREADS, repeat, animate);
+		builds.push_back(c);
+	}
+
+	if (output_path.empty()) { write_json(std::cout, results, ops, sampling, curves, layouts, traversals, builds, settings, repeat); }
+	else {
+		std::ofstream out(output_path);
+		write_json(out, results, ops, sampling, curves, layouts, traversals, builds, settings, repeat);
+		if (!out) { std::cerr << "Cannot write " << output_path << '\n'; return 1; }
+	}
+	return 0;
+}
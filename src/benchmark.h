@@ -0,0 +1,665 @@
+/***********************************************************************************
+*   benchmark.h     
+*   (  )    .
+*
+*      (steady_clock),   
+*    ,     (,
+* hittable_list  bvh_node)        .
+***********************************************************************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <malloc.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "arena.h"
+#include "bvh.h"
+#include "flat_bvh.h"
+#include "wide_bvh.h"
+#include "hittable.h"
+#include "camera.h"
+#include "material.h"
+#include "scheduler.h"
+#include "image_diff.h"
+
+/*
+ *  count    origin     box.
+*/
+inline std::vector<ray> make_benchmark_rays(const point3& origin, const aabb& box, int count, uint64_t seed)
+{
+	rng gen(seed);
+	std::vector<ray> rays;
+	rays.reserve(count);
+	for (int i = 0; i < count; ++i) {
+		double x = random_double(gen, box.x.min, box.x.max);
+		double y = random_double(gen, box.y.min, box.y.max);
+		double z = random_double(gen, box.z.min, box.z.max);
+		rays.push_back(ray(origin, point3(x, y, z) - origin));
+	}
+	return rays;
+}
+
+/*  :  ,     */
+struct bench_result
+{
+	long long rays = 0;
+	long long hits = 0;
+	double    seconds = 0;
+
+	double rays_per_second() const { return seconds > 0 ? rays / seconds : 0; }
+};
+
+/*
+ *  bench_hit()  world.hit()    rays,  
+ * repeat .       .
+*/
+inline bench_result bench_hit(const hittable& world, const std::vector<ray>& rays, int repeat = 1)
+{
+	bench_result res;
+	hit_record rec;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int k = 0; k < repeat; ++k) {
+		for (const ray& r : rays) {
+			if (world.hit(r, interval(0, INF), rec)) { ++res.hits; }
+		}
+	}
+	auto stop = std::chrono::steady_clock::now();
+
+	res.rays    = (long long)rays.size() * repeat;
+	res.seconds = std::chrono::duration<double>(stop - start).count();
+	return res;
+}
+
+/*
+ *   ,      (camera::ambient_occlusion()):
+ *    primary,  world, -      
+ *     distance, ..  t  (0, 1).
+*/
+inline std::vector<ray> make_occlusion_rays(const hittable& world, const std::vector<ray>& primary, double distance, uint64_t seed)
+{
+	rng gen(seed);
+	std::vector<ray> rays;
+	rays.reserve(primary.size());
+	hit_record rec;
+	for (const ray& r : primary) {
+		if (!world.hit(r, interval(0, INF), rec)) { continue; }
+		rays.push_back(rec.spawn_ray(real(distance) * random_on_hemisphere(gen, rec.normal)));
+	}
+	return rays;
+}
+
+/*  bench_visibility(): hits -    */
+struct visibility_result
+{
+	bench_result hit;		// world.hit()    
+	bench_result occluded;	// world.occluded()
+
+	double speedup() const { return hit.seconds > 0 && occluded.seconds > 0 ? hit.seconds / occluded.seconds : 0; }
+};
+
+/*
+ *  bench_visibility()        -   
+ * t  (0, 1)   rays, -  :   
+ * hit()   occluded(),     
+ * .     .
+*/
+inline visibility_result bench_visibility(const hittable& world, const std::vector<ray>& rays, int repeat = 1)
+{
+	visibility_result res;
+	hit_record rec;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int k = 0; k < repeat; ++k) {
+		for (const ray& r : rays) {
+			if (world.hit(r, interval(0, 1), rec)) { ++res.hit.hits; }
+		}
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (int k = 0; k < repeat; ++k) {
+		for (const ray& r : rays) {
+			if (world.occluded(r, interval(0, 1))) { ++res.occluded.hits; }
+		}
+	}
+	auto stop = std::chrono::steady_clock::now();
+
+	res.hit.rays      = res.occluded.rays = (long long)rays.size() * repeat;
+	res.hit.seconds      = std::chrono::duration<double>(middle - start).count();
+	res.occluded.seconds = std::chrono::duration<double>(stop - middle).count();
+	return res;
+}
+
+/*
+ *  bench_render()    cam (  ) 
+ *    ()   ; rays_per_second()  
+ *     .
+*/
+inline bench_result bench_render(camera cam, const hittable& world, const material_table& materials)
+{
+	bench_result res;
+
+	auto start = std::chrono::steady_clock::now();
+	cam.render_frame(world, materials);
+	auto stop = std::chrono::steady_clock::now();
+
+	res.rays    = (long long)cam.image().get_width() * cam.image().get_height() * cam.SAMPLES_PER_PIXEL;
+	res.seconds = std::chrono::duration<double>(stop - start).count();
+	return res;
+}
+
+/*  bench_vec3_ops():       */
+struct vec3_ops_result
+{
+	double add_ns    = 0;
+	double dot_ns    = 0;
+	double cross_ns  = 0;
+	double length_ns = 0;
+	double unitv_ns  = 0;
+};
+
+/*
+ *  bench_vec3_ops()   vec3 (  
+ * , . vec3_simd.h)    .  
+ *     ,     
+ *     ;      .
+*/
+inline vec3_ops_result bench_vec3_ops(int count = 4096, int repeat = 500)
+{
+	rng gen(3);
+	std::vector<vec3> a(count), b(count);
+	for (int k = 0; k < count; ++k) { 
+		a[k] = vec3::random(gen, -1, 1); 
+		b[k] = vec3::random(gen, -1, 1); 
+	}
+
+	auto run = [&](auto&& body) {
+		vec3 acc(0, 0, 0);
+		auto start = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeat; ++r) {
+			for (int k = 0; k < count; ++k) { acc = body(acc, a[k], b[k]); }
+		}
+		auto stop = std::chrono::steady_clock::now();
+		volatile real sink = acc.x() + acc.y() + acc.z();
+		(void)sink;
+		return std::chrono::duration<double, std::nano>(stop - start).count() / (double(count) * repeat);
+	};
+
+	vec3_ops_result res;
+	res.add_ns    = run([](const vec3& acc, const vec3& u, const vec3& v) { return acc + u + v; });
+	res.dot_ns    = run([](const vec3& acc, const vec3& u, const vec3& v) { return vec3(acc.x() + dot(u, v), acc.y(), acc.z()); });
+	res.cross_ns  = run([](const vec3& acc, const vec3& u, const vec3& v) { return cross(acc + u, v); });
+	res.length_ns = run([](const vec3& acc, const vec3& u, const vec3&)   { return vec3(acc.x() + u.length(), acc.y(), acc.z()); });
+	res.unitv_ns  = run([](const vec3& acc, const vec3& u, const vec3&)   { return unitv(acc + u); });
+	return res;
+}
+
+/*        bench_sampling() */
+namespace bench_detail
+{
+	inline vec3 rejection_unit_vector(rng& gen)
+	{
+		for (;;) {
+			vec3 p = vec3::random(gen, -1, 1);
+			real lensq = p.length_squared();
+			if (1e-160 < lensq && lensq <= 1) { return p / std::sqrt(lensq); }
+		}
+	}
+
+	inline vec3 rejection_in_unit_disk(rng& gen)
+	{
+		for (;;) {
+			real x = real(random_double(gen, -1, 1));
+			real y = real(random_double(gen, -1, 1));
+			vec3 p = vec3(x, y, 0);
+			if (p.length_squared() < 1) { return p; }
+		}
+	}
+}
+
+/*  bench_sampling():       */
+struct sampling_result
+{
+	double rejection_sphere_ns = 0;	//  random_unit_vector()
+	double warp_sphere_ns      = 0;	// sample_uniform_sphere()  rng
+	double rejection_disk_ns   = 0;	//  random_in_unit_disk()
+	double warp_disk_ns        = 0;	// sample_concentric_disk()  rng
+	double batch_sphere_ns     = 0;	// *_batch()    
+	double batch_cosine_ns     = 0;
+	double batch_disk_ns       = 0;
+};
+
+/*
+ *  bench_sampling()       
+ *     (sampling.h).  " rng" 
+ *   ,  -    .
+ *     repeat ,      .
+*/
+inline sampling_result bench_sampling(int count = 4096, int repeat = 256)
+{
+	using namespace bench_detail;
+
+	auto per_sample = [count, repeat](auto&& body) {
+		auto start = std::chrono::steady_clock::now();
+		for (int k = 0; k < repeat; ++k) { body(); }
+		auto stop = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(stop - start).count() / (double(count) * repeat);
+	};
+	std::vector<vec3> out(count);
+	rng gen(5);
+	auto single = [&](auto&& sample) {
+		return per_sample([&]() {
+			for (vec3& p : out) { p = sample(gen); }
+		});
+	};
+
+	sampling_result res;
+	res.rejection_sphere_ns = single(rejection_unit_vector);
+	res.warp_sphere_ns      = single(random_unit_vector);
+	res.rejection_disk_ns   = single(rejection_in_unit_disk);
+	res.warp_disk_ns        = single(random_in_unit_disk);
+
+	std::vector<sample2> points(count);
+	for (sample2& s : points) { s = sample2::random(gen); }
+	res.batch_sphere_ns = per_sample([&]() { sample_uniform_sphere_batch(points.data(), out.data(), out.size()); });
+	res.batch_cosine_ns = per_sample([&]() { sample_cosine_hemisphere_batch(points.data(), out.data(), out.size()); });
+	res.batch_disk_ns   = per_sample([&]() { sample_concentric_disk_batch(points.data(), out.data(), out.size()); });
+
+	volatile real sink = out[count / 2].x();
+	(void)sink;
+	return res;
+}
+
+/*   :       */
+struct convergence_point
+{
+	sampler_type type = sampler_type::independent;
+	int    spp     = 0;
+	double rmse    = 0;	//     
+	double seconds = 0;
+};
+
+/*
+ *  bench_convergence()    cam    
+ *   budgets   RMSE     -   reference_spp
+ *     SEED (     
+ * ).     RMSE   ,  reference_spp
+ *      .
+*/
+inline std::vector<convergence_point> bench_convergence(camera cam, const hittable& world, const material_table& materials,
+	const std::vector<int>& budgets, int reference_spp)
+{
+	cam.PASS_SPP = 0;
+	cam.ADAPTIVE = false;
+
+	camera ref = cam;
+	ref.SAMPLER = sampler_type::independent;
+	ref.SAMPLES_PER_PIXEL = reference_spp;
+	ref.SEED = cam.SEED + 1;
+	ref.render_frame(world, materials);
+
+	std::vector<convergence_point> points;
+	for (sampler_type type : { sampler_type::independent, sampler_type::stratified, sampler_type::sobol }) {
+		for (int spp : budgets) {
+			cam.SAMPLER = type;
+			cam.SAMPLES_PER_PIXEL = spp;
+			auto start = std::chrono::steady_clock::now();
+			cam.render_frame(world, materials);
+			auto stop = std::chrono::steady_clock::now();
+
+			convergence_point p;
+			p.type    = type;
+			p.spp     = spp;
+			p.rmse    = compare_images(ref.image(), cam.image()).rmse;
+			p.seconds = std::chrono::duration<double>(stop - start).count();
+			points.push_back(p);
+		}
+	}
+	return points;
+}
+
+/*
+ *       bench_material_dispatch():
+ *      scatter(),     
+ *   shared_ptr.
+*/
+namespace bench_detail
+{
+	class virtual_material
+	{
+	public:
+		virtual ~virtual_material() = default;
+		virtual bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered, sampler& gen) const = 0;
+	};
+
+	template <typename M>
+	class virtual_material_adapter : public virtual_material
+	{
+	private:
+		M m;
+	public:
+		explicit virtual_material_adapter(const M& m) : m(m) {}
+		bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered, sampler& gen) const override
+		{
+			bsdf_sample bs;
+			if (!m.sample(r_in, rec, gen, bs)) { return false; }
+			attenuation = bs.weight(rec.normal);
+			scattered   = rec.spawn_ray(bs.direction);
+			return true;
+		}
+	};
+
+	struct shared_hit_record
+	{
+		hit_record rec;
+		shared_ptr<virtual_material> mat;
+	};
+}
+
+/*  bench_material_dispatch():       */
+struct dispatch_result
+{
+	int    threads    = 1;
+	double virtual_ns = 0;
+	double variant_ns = 0;
+};
+
+/*
+ *  bench_material_dispatch()     :
+ *       (  sphere::hit()),  
+ * (  hittable_list::hit())   scatter().   - shared_ptr 
+ *  ,  -   material_table     variant.
+ *          ,   
+ *      .
+*/
+inline dispatch_result bench_material_dispatch(const material_table& materials, int hits, int threads = 0)
+{
+	using namespace bench_detail;
+
+	dispatch_result res;
+	res.threads = resolve_thread_count(threads);
+	if (materials.size() == 0) { return res; }
+
+	std::vector<shared_ptr<virtual_material>> legacy;
+	for (uint32_t m = 0; m < materials.size(); ++m) {
+		legacy.push_back(std::visit([](const auto& mat) -> shared_ptr<virtual_material> {
+			return make_shared<virtual_material_adapter<std::decay_t<decltype(mat)>>>(mat);
+		}, materials[m]));
+	}
+
+	rng seq_gen(7);
+	std::vector<uint32_t> sequence(hits);
+	for (uint32_t& id : sequence) { id = seq_gen.next_uint() % uint32_t(materials.size()); }
+
+	hit_record base;
+	base.p = point3(0, 0, 0);
+	base.normal = vec3(0, 1, 0);
+	base.t = 1.0;
+	base.front_face = true;
+	const ray r_in(point3(-1, 1, 0), vec3(1, -1, 0));
+
+	auto run = [&](auto&& body) {
+		std::vector<std::thread> pool;
+		auto start = std::chrono::steady_clock::now();
+		for (int id = 0; id < res.threads; ++id) {
+			pool.emplace_back([&, id]() {
+				sampler gen{rng(id)};
+				volatile double sink = 0;
+				double acc = 0;
+				for (uint32_t mat_id : sequence) { acc += body(mat_id, gen); }
+				sink = acc;
+				(void)sink;
+			});
+		}
+		for (std::thread& t : pool) { t.join(); }
+		auto stop = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(stop - start).count() / hits;
+	};
+
+	res.virtual_ns = run([&](uint32_t mat_id, sampler& gen) {
+		shared_hit_record temp;
+		temp.rec = base;
+		temp.mat = legacy[mat_id];
+		shared_hit_record rec = temp;
+		color attenuation;
+		ray   scattered;
+		rec.mat->scatter(r_in, rec.rec, attenuation, scattered, gen);
+		return attenuation.x();
+	});
+
+	res.variant_ns = run([&](uint32_t mat_id, sampler& gen) {
+		hit_record temp = base;
+		temp.mat_id = mat_id;
+		hit_record rec = temp;
+		color attenuation;
+		ray   scattered;
+		scatter(materials[rec.mat_id], r_in, rec, attenuation, scattered, gen);
+		return attenuation.x();
+	});
+
+	return res;
+}
+
+/*
+ *         (Linux,
+ * perf_event_open).         :
+ * stop()  -1.
+*/
+class cache_miss_counter
+{
+private:
+	int fd = -1;
+
+public:
+	cache_miss_counter()
+	{
+#ifdef __linux__
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.type           = PERF_TYPE_HARDWARE;
+		attr.size           = sizeof(attr);
+		attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled       = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv     = 1;
+		fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+	}
+	cache_miss_counter(const cache_miss_counter&) = delete;
+	cache_miss_counter& operator=(const cache_miss_counter&) = delete;
+
+	~cache_miss_counter()
+	{
+#ifdef __linux__
+		if (fd >= 0) { close(fd); }
+#endif
+	}
+
+	bool available() const { return fd >= 0; }
+
+	void start()
+	{
+#ifdef __linux__
+		if (fd < 0) { return; }
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+
+	long long stop()
+	{
+#ifdef __linux__
+		if (fd < 0) { return -1; }
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		long long count = 0;
+		if (read(fd, &count, sizeof(count)) != ssize_t(sizeof(count))) { return -1; }
+		return count;
+#else
+		return -1;
+#endif
+	}
+};
+
+/*  bench_bvh_layout()     */
+struct layout_result
+{
+	double       build_ms     = 0;
+	double       release_ms   = 0;	//  
+	int          nodes        = 0;
+	size_t       heap_bytes   = 0;	//       (glibc),  
+	size_t       allocations  = 0;	//     
+	bench_result trace;				// world.hit()   
+	long long    cache_misses = -1;	//     (-1 -  )
+};
+
+/*
+ *  bench_bvh_layout()  bvh_node  world     (
+ *     shared_ptr  )    scene_arena (arena.h) 
+ *     rays repeat .  ,  
+ *    .
+*/
+inline layout_result bench_bvh_layout(const hittable_list& world, const std::vector<ray>& rays, bool in_arena, int repeat = 1)
+{
+	layout_result res;
+	bvh_stats stats;
+	scene_arena arena;
+	shared_ptr<hittable> root;
+
+#if defined(__GLIBC__)
+	auto heap_in_use = []() { struct mallinfo2 info = mallinfo2(); return info.uordblks + info.hblkhd; };
+	size_t heap_before = heap_in_use();
+#endif
+	auto start = std::chrono::steady_clock::now();
+	if (in_arena) { root = shared_ptr<hittable>(shared_ptr<hittable>(), arena.create<bvh_node>(world, &arena, &stats)); }
+	else { root = make_shared<bvh_node>(world, &stats); }
+	res.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	res.nodes = stats.nodes;
+	res.allocations = in_arena ? arena.block_count() : size_t(stats.nodes) * 2 - 1; //    ,  - make_shared
+#if defined(__GLIBC__)
+	res.heap_bytes = heap_in_use() - heap_before;
+#else
+	res.heap_bytes = in_arena ? arena.bytes_reserved() : size_t(stats.nodes) * sizeof(bvh_node);
+#endif
+
+	cache_miss_counter misses;
+	misses.start();
+	res.trace = bench_hit(*root, rays, repeat);
+	res.cache_misses = misses.stop();
+
+	start = std::chrono::steady_clock::now();
+	root.reset();
+	arena.release();
+	res.release_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return res;
+}
+
+/*  bench_bvh_build()     */
+struct build_result
+{
+	std::string  mode;		// sah, morton, refit  sah_rebuild
+	int          threads = 1;
+	bvh_stats    stats;		//     SAH
+	bench_result trace;		// hit()   
+};
+
+/*
+ *  bench_bvh_build()  flat_bvh  world  SAH     
+ *     threads ,   animate() ( world
+ * ,   )     SAH (refit) 
+ * .      rays repeat .
+*/
+inline std::vector<build_result> bench_bvh_build(const hittable_list& world, const std::vector<ray>& rays, int threads, int repeat,
+												 const std::function<void()>& animate)
+{
+	std::vector<build_result> results;
+	threads = resolve_thread_count(threads);
+	auto measure = [&](const char* mode, int used_threads, const flat_bvh& tree) {
+		build_result res;
+		res.mode    = mode;
+		res.threads = used_threads;
+		res.stats   = tree.hierarchy_stats();
+		res.trace   = bench_hit(tree, rays, repeat);
+		results.push_back(res);
+	};
+
+	std::vector<int> thread_counts = { 1 };
+	if (threads > 1) { thread_counts.push_back(threads); }
+	for (bvh_build mode : { bvh_build::sah, bvh_build::morton }) {
+		for (int t : thread_counts) {
+			flat_bvh tree(world, nullptr, mode, t);
+			measure(bvh_build_name(mode), t, tree);
+		}
+	}
+
+	flat_bvh tree(world, nullptr, bvh_build::sah, threads);
+	animate();
+	tree.refit();
+	measure("refit", 1, tree);
+	flat_bvh rebuilt(world, nullptr, bvh_build::sah, threads);
+	measure("sah_rebuild", threads, rebuilt);
+	return results;
+}
+
+/*  bench_bvh_traversal()    */
+struct traversal_result
+{
+	std::string       name;
+	bvh_stats         stats;
+	size_t            node_bytes = 0;	//     
+	bench_result      trace;			// hit()   
+	visibility_result visibility;		// hit()  occluded()    1
+};
+
+/*
+ *  bench_bvh_traversal()   world  bvh_node (  
+ * scene_arena), flat_bvh  wide_bvh (   ,  
+ *  AVX2,  )         .
+*/
+inline std::vector<traversal_result> bench_bvh_traversal(const hittable_list& world, const std::vector<ray>& rays, int repeat = 1)
+{
+	std::vector<traversal_result> results;
+	std::vector<ray> shadow_rays;
+	auto measure = [&](const std::string& name, const hittable& root, const bvh_stats& stats, size_t node_bytes) {
+		if (shadow_rays.empty()) { shadow_rays = make_occlusion_rays(root, rays, 1.0, 2); }
+		traversal_result res;
+		res.name       = name;
+		res.stats      = stats;
+		res.node_bytes = node_bytes;
+		res.trace      = bench_hit(root, rays, repeat);
+		res.visibility = bench_visibility(root, shadow_rays, repeat);
+		results.push_back(res);
+	};
+
+	{
+		scene_arena arena;
+		bvh_stats   stats;
+		bvh_node* root = arena.create<bvh_node>(world, &arena, &stats);
+		measure("bvh_node", *root, stats, arena.bytes_used());
+	}
+	{
+		flat_bvh root(world);
+		measure("flat_bvh", root, root.hierarchy_stats(), root.memory_bytes());
+	}
+	wide_bvh root(world);
+	for (simd_level l : { simd_level::scalar, simd_level::avx2 }) { //  AVX-512   AVX2
+		if (l > detect_simd_level()) { break; }
+		root.set_simd_level(l);
+		measure(std::string("wide_bvh/") + simd_level_name(l), root, root.hierarchy_stats(), root.memory_bytes());
+	}
+	return results;
+}
+
+#endif
@@ -0,0 +1,245 @@
+/***********************************************************************************
+*   bvh.h     (bounding
+* volume hierarchy) -  ,     
+* (aabb.h),     .
+*
+* hittable_list::hit()       , ..
+*    O(N).  bvh_node     
+*  ,     ,    ,
+*       O(log N).
+*
+* /    (SAH) /
+*  ,  ,    ,   
+*  ,      .
+*       L  R:
+*
+*     C = S(L)/S(P) * N(L) + S(R)/S(P) * N(R),
+*
+*  S -  , N -  .    
+*         ,  
+*        C.   
+*  .
+*
+* /   /
+*     -       
+* shared_ptr,         
+*  .      (scene_arena, arena.h) 
+*        (  ),  
+*          (  ,  
+* scene::world()), ..    .    
+*     ;    ,    
+*    .   ,   ,
+*     .
+***********************************************************************************/
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "arena.h"
+#include "hittable.h"
+#include "hittable_list.h"
+
+/*     */
+struct bvh_stats
+{
+	int    nodes     = 0;	//   bvh_node
+	int    leaves    = 0;	//  ,     
+	int    max_depth = 0;	//  
+	double build_ms  = 0;	//    
+	double sah_cost  = 0;	//    SAH (flat_builder::sah_cost(), 0 -  )
+
+	void report(std::ostream& out) const
+	{
+		out << "BVH: " << nodes << " nodes, " << leaves << " leaves, depth " << max_depth
+			<< ", built in " << build_ms << " ms";
+		if (sah_cost > 0) { out << ", SAH cost " << sah_cost; }
+		out << '\n';
+	}
+};
+
+class bvh_node : public hittable
+{
+private:
+	shared_ptr<hittable> left;
+	shared_ptr<hittable> right;
+	aabb bbox;
+
+	static bool centroid_less(const shared_ptr<hittable>& a, const shared_ptr<hittable>& b, int axis)
+	{
+		return a->bounding_box().centroid()[axis] < b->bounding_box().centroid()[axis];
+	}
+
+	/*
+	 *       [start,end)    SAH.
+	 *      ,   
+	 *   .
+	*/
+	static size_t sah_split(std::vector<shared_ptr<hittable>>& objects, size_t start, size_t end)
+	{
+		size_t count = end - start;
+		std::vector<double> left_area(count);
+
+		int    best_axis  = 0;
+		size_t best_split = start + count/2;
+		double best_cost  = INF;
+
+		for (int axis = 0; axis < 3; ++axis) {
+			std::sort(objects.begin() + start, objects.begin() + end,
+				[axis](const shared_ptr<hittable>& a, const shared_ptr<hittable>& b) { return centroid_less(a, b, axis); });
+
+			// left_area[i] -    [start, start+i].
+			aabb box;
+			for (size_t i = 0; i < count; ++i) {
+				box = aabb(box, objects[start + i]->bounding_box());
+				left_area[i] = box.surface_area();
+			}
+
+			//   :    i,  (count - i) .
+			box = aabb();
+			for (size_t i = count - 1; i > 0; --i) {
+				box = aabb(box, objects[start + i]->bounding_box());
+				double cost = left_area[i-1] * double(i) + box.surface_area() * double(count - i);
+				if (cost < best_cost) {
+					best_cost  = cost;
+					best_axis  = axis;
+					best_split = start + i;
+				}
+			}
+		}
+
+		if (best_axis != 2) {
+			std::sort(objects.begin() + start, objects.begin() + end,
+				[best_axis](const shared_ptr<hittable>& a, const shared_ptr<hittable>& b) { return centroid_less(a, b, best_axis); });
+		}
+		return best_split;
+	}
+
+	bvh_node(std::vector<shared_ptr<hittable>>& objects, size_t start, size_t end, bvh_stats& stats, int depth, scene_arena* arena)
+	{
+		build(objects, start, end, stats, depth, arena);
+	}
+
+	/*   [start,end):   arena ( )    */
+	static shared_ptr<hittable> make_child(std::vector<shared_ptr<hittable>>& objects, size_t start, size_t end,
+		bvh_stats& stats, int depth, scene_arena* arena)
+	{
+		if (!arena) { return shared_ptr<bvh_node>(new bvh_node(objects, start, end, stats, depth, nullptr)); }
+		bvh_node* node = new (arena->allocate(sizeof(bvh_node), alignof(bvh_node))) bvh_node(objects, start, end, stats, depth, arena);
+		return shared_ptr<hittable>(shared_ptr<hittable>(), node);
+	}
+
+	/*    :     -   */
+	static shared_ptr<hittable> leaf(const shared_ptr<hittable>& object, scene_arena* arena)
+	{
+		return arena ? shared_ptr<hittable>(shared_ptr<hittable>(), object.get()) : object;
+	}
+
+	void build(std::vector<shared_ptr<hittable>>& objects, size_t start, size_t end, bvh_stats& stats, int depth, scene_arena* arena)
+	{
+		++stats.nodes;
+		if (depth > stats.max_depth) { stats.max_depth = depth; }
+
+		size_t count = end - start;
+		if (count == 1) {
+			left = right = leaf(objects[start], arena);
+			++stats.leaves;
+		}
+		else if (count == 2) {
+			left  = leaf(objects[start], arena);
+			right = leaf(objects[start + 1], arena);
+			++stats.leaves;
+		}
+		else {
+			size_t mid = sah_split(objects, start, end);
+			left  = make_child(objects, start, mid, stats, depth + 1, arena);
+			right = make_child(objects, mid, end, stats, depth + 1, arena);
+		}
+
+		bbox = aabb(left->bounding_box(), right->bounding_box());
+	}
+
+public:
+	/*
+	 *      , ..    -
+	 * .   stats,      .  
+	 *  arena,      (.  ).
+	*/
+	bvh_node(hittable_list list, bvh_stats* stats = nullptr) : bvh_node(std::move(list), nullptr, stats) {}
+
+	bvh_node(hittable_list list, scene_arena* arena, bvh_stats* stats = nullptr)
+	{
+		bvh_stats local;
+		bvh_stats& s = stats ? *stats : local;
+		s = bvh_stats();
+
+		auto start = std::chrono::steady_clock::now();
+		if (!list.objects.empty()) { build(list.objects, 0, list.objects.size(), s, 1, arena); }
+		if (arena && std::any_of(list.objects.begin(), list.objects.end(), [](const shared_ptr<hittable>& p) { return p.use_count() > 0; })) {
+			arena->create<std::vector<shared_ptr<hittable>>>(std::move(list.objects)); // ,   
+		}
+		auto stop = std::chrono::steady_clock::now();
+
+		s.build_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+	}
+
+	/*
+	 *     ,   .  
+	 *   ,     , 
+	 * rec   .
+	*/
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		RT_COUNT(node_tests, 1);
+		if (!left || !bbox.hit(r, ray_t)) { return false; }
+
+		bool hit_left  = left->hit(r, ray_t, rec);
+		bool hit_right = right->hit(r, interval(ray_t.min, hit_left ? rec.t : ray_t.max), rec);
+
+		return hit_left || hit_right;
+	}
+
+	/*          */
+	bool occluded(const ray& r, interval ray_t) const override
+	{
+		RT_COUNT(node_tests, 1);
+		if (!left || !bbox.hit(r, ray_t)) { return false; }
+		return left->occluded(r, ray_t) || (right != left && right->occluded(r, ray_t));
+	}
+
+	/*
+	 *  :      ,    
+	 *  ,   .    (
+	 * )        ,    
+	 *      ,     .
+	*/
+	void hit_packet(const ray* rays, const int* active, int count, interval ray_t,
+		hit_record* recs, bool* hits) const override
+	{
+		if (!left) { return; }
+		if (count == 1) { //      -   
+			int k = active[0];
+			if (hit(rays[k], interval(ray_t.min, hits[k] ? recs[k].t : ray_t.max), recs[k])) { hits[k] = true; }
+			return;
+		}
+
+		RT_COUNT(node_tests, count);
+		int inside[MAX_PACKET_SIZE];
+		int n = 0;
+		for (int m = 0; m < count; ++m) {
+			int k = active[m];
+			if (bbox.hit(rays[k], interval(ray_t.min, hits[k] ? recs[k].t : ray_t.max))) { inside[n++] = k; }
+		}
+		if (n == 0) { return; }
+
+		left->hit_packet(rays, inside, n, ray_t, recs, hits);
+		if (right != left) { right->hit_packet(rays, inside, n, ray_t, recs, hits); }
+	}
+
+	aabb bounding_box() const override { return bbox; }
+};
+
+#endif
@@ -16,13 +16,77 @@
 ***********************************************************************************/
 
 #ifndef CAMERA_H
-#define CANERA_H
+#define CAMERA_H
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "arena.h"
 #include "hittable.h"
 #include "material.h"
+#include "light.h"
+#include "scheduler.h"
+#include "framebuffer.h"
+#include "image_writer.h"
+#include "checkpoint.h"
+
+/*    */
+enum class render_mode 
+{ 
+	scalar, //       (ray_color())
+	stream	//        
+};
+
+/* ,     */
+enum class shading_mode
+{
+	path,				//   (ray_color())
+	ambient_occlusion	//      
+};
+
+/*     */
+struct render_stats
+{
+	long long paths    = 0;	//   ()
+	long long segments = 0;	//     
+	long long roulette = 0;	//  ,   
+	long long shadow   = 0;	//    (  )
+	int       max_spp  = 0;	//     
+
+	void merge(const render_stats& other)
+	{
+		paths    += other.paths;
+		segments += other.segments;
+		roulette += other.roulette;
+		shadow   += other.shadow;
+		max_spp   = std::max(max_spp, other.max_spp);
+	}
+
+	double average_path_length() const { return paths > 0 ? double(segments) / paths : 0; }
+	double roulette_share()      const { return paths > 0 ? double(roulette) / paths : 0; }
+
+	void report(std::ostream& out) const
+	{
+		out << "Paths: " << paths << ", average length " << average_path_length()
+			<< ", ended by roulette " << 100.0 * roulette_share() << '%';
+		if (shadow > 0) { out << ", shadow rays " << double(shadow) / paths << " per path"; }
+		out << '\n';
+	}
+};
+
 class camera
 {
 private:
+	/*    [x0,x1) x [y0,y1),     */
+	struct tile
+	{
+		int index;
+		int x0, y0, x1, y1;
+	};
+
 	int    IMAGE_HEIGHT;        //     
 	double PIXEL_SAMPLES_SCALE; //          
 								//       (i,j) .
@@ -33,6 +97,15 @@ private:
 	vec3   U, W, V;				//  
 	vec3   FOCUS_DISK_U, 		//   
 		   FOCUS_DISK_V;		
+	framebuffer FRAME;			//   (  )
+	std::vector<int> PIXEL_SPP;	//     ( )
+	render_stats STATS;			//   
+	const material_table* MATERIALS = nullptr; //    
+	const light_list*     LIGHTS    = nullptr; //    (nullptr -  )
+
+	instrument_counters COUNTERS;			//   (  RT_INSTRUMENT, . instrument.h)
+	std::vector<double> TILE_MS;			//       (RT_INSTRUMENT)
+	mutable std::vector<float> PIXEL_COST;	//       (RT_INSTRUMENT)
 
 	void initialize()
 	{
@@ -83,15 +156,36 @@ private:
 	 *     .      
 	 * world.hit()  true  ray_color    "" .
 	 *
-	 *  ray_color()  ,    
-	 *   ,      .   
-	 *        (  -
-	 * ).    ,    
-	 *  .
+	 *  ray_color() :      
+	 *    throughput      
+	 *     .    throughput,  
+	 *  ,      .      , 
+	 *    MAX_DEPTH.
+	 *
+	 * /   /
+	 *     throughput     ,   
+	 * ,   .   RR_MIN_DEPTH   
+	 * throughput q  RR_THRESHOLD,     q,  
+	 * throughput   q.       
+	 *  (q * throughput/q + (1-q) * 0), ..   , 
+	 *      .
 	 * 
 	 *        ,  
 	 *    ,      
 	 *    .    .
+	 *
+	 * /  - /
+	 *    wo   f(wo, wi) * L(wi) * |cos(wi, n)| 
+	 *  wi.       pdf
+	 * (sample_bsdf()),     f * |cos| / pdf * L(wi),  L(wi)
+	 *     .  f*|cos|/pdf (bsdf_sample::weight())
+	 *   throughput.      :
+	 *     ,    pdf  .
+	 *
+	 * /   /
+	 *     radiance:   diffuse_light,  
+	 *  ,         LIGHTS (.
+	 * shade()  direct_light()).      MIS (light.h).
 	 * 
 	 *      ,    
 	 *  ,     .    a  , 
@@ -100,30 +194,163 @@ private:
 	 * -       P(t)    , 
 	 *        .    -
 	 *   ,   P(t)    ,  
-	 *     .    ,   -
-	 *           
-	 *  ,  0.001.
+	 *     .       P(t), 
+	 *  ,       (hit_record::spawn_ray()),
+	 *       t > 0.
 	*/
-	color ray_color(const ray& r, int max_depth, const hittable& world) const
+	color ray_color(const ray& r_in, const hittable& world, sampler& gen, render_stats& stats) const
 	{
-		if (max_depth <= 0) { return color(0,0,0); }
+		if (SHADING == shading_mode::ambient_occlusion) { return ambient_occlusion(r_in, world, gen, stats); }
+
+		ray   r = r_in;
+		color throughput(1,1,1);	//    .
+		color radiance(0,0,0);		// ,     .
+		bounce_record last;
+		++stats.paths;
+
+		for (int depth = 0; depth < MAX_DEPTH; ++depth) {
+			++stats.segments;
+			RT_COUNT(primary_rays, depth == 0);
+			RT_COUNT(secondary_rays, depth != 0);
+
+			hit_record rec;
+			if (!world.hit(r, interval(0, INF), rec)) { 
+				RT_COUNT_PATH(depth + 1);
+				return radiance + throughput * background(r); 
+			}
 
-		hit_record rec;
-		if (world.hit(r, interval(0.001, INF), rec)) {                 
-			ray   scattered;	//  
-			color attenuation;	//      (  sky).
-			
 			/*       */
-			if (rec.mat->scatter(r, rec, attenuation, scattered))
-				return attenuation * ray_color(scattered, max_depth-1, world);
-			return color(0,0,0);
+			ray scattered;
+			if (!shade(r, rec, world, depth, gen, throughput, last, radiance, scattered, stats)) { 
+				RT_COUNT_PATH(depth + 1);
+				return radiance; 
+			}
+			r = scattered;
+		}
+		RT_COUNT_PATH(MAX_DEPTH);
+		return radiance;
+	}
+
+	/*
+	 *   (SHADING == shading_mode::ambient_occlusion).  
+	 *        cos(theta)/PI, 
+	 *  1,    AO_DISTANCE    ,  0 ;
+	 *   -      cos(theta).  
+	 *  "/",    world.occluded(),   hit(). 
+	 *   -   (1).
+	*/
+	color ambient_occlusion(const ray& r, const hittable& world, sampler& gen, render_stats& stats) const
+	{
+		++stats.paths;
+		++stats.segments;
+		RT_COUNT(primary_rays, 1);
+		RT_COUNT_PATH(1);
+
+		hit_record rec;
+		if (!world.hit(r, interval(0, INF), rec)) { return color(1,1,1); }
+
+		gen.start_bounce(0);
+		vec3 dir = onb(rec.normal).to_world(sample_cosine_hemisphere(gen.get_2d()));
+		++stats.shadow;
+		bool blocked = world.occluded(rec.spawn_ray(dir), interval(0, real(AO_DISTANCE)));
+		return blocked ? color(0,0,0) : color(1,1,1);
+	}
+
+	/*   :    MIS,      */
+	struct bounce_record
+	{
+		point3 p;				//  
+		double pdf      = 0;	//     
+		bool   specular = true;	// -   :     1
+	};
+
+	bool sample_lights() const { return LIGHT_SAMPLING && LIGHTS && !LIGHTS->empty(); }
+
+	/*
+	 *     rec   bounce (  ray_color() 
+	 *  ):     MIS,  ,
+	 *    scattered   .   
+	 * radiance, false -  .      
+	 *  ,      .
+	*/
+	bool shade(const ray& r, const hit_record& rec, const hittable& world, int bounce, sampler& gen,
+		color& throughput, bounce_record& last, color& radiance, ray& scattered, render_stats& stats) const
+	{
+		const material& mat = (*MATERIALS)[rec.mat_id];
+
+		color emit = emitted(mat, rec);
+		if (emit.x() > 0 || emit.y() > 0 || emit.z() > 0) {
+			//      direct_light()    
+			double weight = (last.specular || !sample_lights()) ? 1.0 : power_heuristic(last.pdf, LIGHTS->pdf(last.p, rec));
+			radiance += throughput * emit * real(weight);
+		}
+
+		bsdf_sample bs;		//  ,  BSDF   .
+		gen.start_bounce(bounce);
+		if (!sample_bsdf(mat, r, rec, gen, bs) || bs.pdf <= 0) { return false; }
+
+		if (!bs.specular && sample_lights()) {
+			radiance += throughput * direct_light(r, rec, mat, world, bounce, gen, stats);
+		}
+
+		throughput = throughput * bs.weight(rec.normal);
+		last.p        = rec.p;
+		last.pdf      = bs.pdf;
+		last.specular = bs.specular;
+		scattered = rec.spawn_ray(bs.direction);
+		return survive_roulette(throughput, bounce + 1, gen, stats);
+	}
+
+	/*
+	 *    rec (next event estimation):    
+	 * light_list::sample(),      (hittable::occluded()).
+	 *  f * Le * |cos| / pdf    MIS  , 
+	 *       .
+	*/
+	color direct_light(const ray& r, const hit_record& rec, const material& mat, const hittable& world,
+		int bounce, sampler& gen, render_stats& stats) const
+	{
+		gen.start_light(bounce);
+		double u_light = gen.get_1d();
+		light_sample ls;
+		if (!LIGHTS->sample(rec.p, u_light, gen.get_2d(), ls)) { return color(0,0,0); }
+
+		vec3  wo = -r.direction();
+		vec3  wi = ls.p - rec.p;
+		color f  = eval_bsdf(mat, rec, wo, wi);
+		if (f.x() <= 0 && f.y() <= 0 && f.z() <= 0) { return color(0,0,0); }
+
+		++stats.shadow;
+		if (world.occluded(ls.shadow_ray(rec), interval(0, 1 - SHADOW_EPSILON))) { return color(0,0,0); }
+
+		double cos_theta = std::fabs(dot(unitv(wi), rec.normal));
+		double weight    = power_heuristic(ls.pdf, bsdf_pdf(mat, rec, wo, wi));
+		return f * ls.emit * real(cos_theta * weight / ls.pdf);
+	}
+
+	/*  : false -  ,  throughput  */
+	bool survive_roulette(color& throughput, int bounces, sampler& gen, render_stats& stats) const
+	{
+		if (RR_THRESHOLD <= 0 || bounces < RR_MIN_DEPTH) { return true; }
+
+		double q = std::fmax(throughput.x(), std::fmax(throughput.y(), throughput.z()));
+		if (q >= RR_THRESHOLD) { return true; }
+		gen.start_roulette(bounces - 1);
+		if (gen.get_1d() >= q) {
+			++stats.roulette;
+			return false;
 		}
+		throughput /= q;
+		return true;
+	}
 
-		/* sky */
+	/* sky */
+	color background(const ray& r) const
+	{
 		vec3 unit_direction = unitv(r.direction());
 		double a = 0.5 * (unit_direction.y() + 1.0); // [-1;1] -> [0;1], 0.0 <= a <= 1.0
 		/* linear interpolation */
-		return (1.0 - a) * color(1.0, 1.0, 1.0) + a * color(0.5, 0.7, 1.0); // a = 1.0 -> , a = 0.0 -> 
+		return SKY_BRIGHTNESS * ((1.0 - a) * color(1.0, 1.0, 1.0) + a * color(0.5, 0.7, 1.0)); // a = 1.0 -> , a = 0.0 -> 
 	}
 	
 	/*
@@ -131,9 +358,9 @@ private:
 	 *     (i,j)  (  ). 
 	 *        .
 	*/
-	ray get_ray(int i, int j) const 
+	ray get_ray(int i, int j, sampler& gen) const 
 	{
-		vec3 offset = sample_square(); //       
+		vec3 offset = sample_square(gen); //       
 									   //   .
 
 		//    (..    (i,j) )   .							   
@@ -145,19 +372,473 @@ private:
 		 *  [-1, 1] +   ,      
 		 *     ( ).
 		*/
-		point3 ray_origin = (FOCUS_ANGLE <= 0) ? CAMERA_CENTER : focus_disk_sample(); 
+		point3 ray_origin = (FOCUS_ANGLE <= 0) ? CAMERA_CENTER : focus_disk_sample(gen); 
 		point3 ray_direction = pixel_sample - ray_origin; //        , 
 														  //      .
 		return ray(ray_origin, ray_direction);
 	}
 
+	std::vector<tile> make_tiles() const
+	{
+		int size = (TILE_SIZE > 0) ? TILE_SIZE : 32;
+		std::vector<tile> tiles;
+		for (int y = 0; y < IMAGE_HEIGHT; y += size) {
+			for (int x = 0; x < IMAGE_WIDTH; x += size) {
+				tiles.push_back({ int(tiles.size()), x, y, std::min(x + size, IMAGE_WIDTH), std::min(y + size, IMAGE_HEIGHT) });
+			}
+		}
+		return tiles;
+	}
+
+	void render_tile(const tile& t, const hittable& world, framebuffer& fb, render_stats& stats) const
+	{
+		for (int j = t.y0; j < t.y1; ++j) {
+			for (int i = t.x0; i < t.x1; ++i) {
+				RT_TIME_SCOPE(PIXEL_COST[size_t(j) * IMAGE_WIDTH + i]);
+				color pixel_color(0,0,0);
+				/* sampling */
+				for (int sample = 0; sample < SAMPLES_PER_PIXEL; ++sample) { 
+					sampler gen = pixel_sampler(i, j, sample);
+					ray r = get_ray(i,j,gen);	//   (i,j)   samples_per_pixel  ()
+
+					/* Antialiasing */
+					pixel_color += ray_color(r, world, gen, stats);		//      
+																   //  (i.j) . 
+				}
+				fb.set(i, j, PIXEL_SAMPLES_SCALE * pixel_color);							   // pixel_color * (1.0 / SAMPLES_PER_PIXEL): 
+																							   //   pixel_color 
+																							   //     (i,j) .
+			}
+		}
+	}
+
+	/*
+	 *    (ADAPTIVE == true).     
+	 *        ( :
+	 *           ). 
+	 * ADAPTIVE_MIN_SPP    ,   95%
+	 *    1.96 * sqrt(var/n)  
+	 * ADAPTIVE_TOLERANCE   (   0.01   ). 
+	 *    SAMPLES_PER_PIXEL.
+	 *
+	 *    ()   ,  , 
+	 *     -  SAMPLES_PER_PIXEL.
+	*/
+	void render_tile_adaptive(const tile& t, const hittable& world, framebuffer& fb, render_stats& stats)
+	{
+		int min_spp = std::max(2, std::min(ADAPTIVE_MIN_SPP, SAMPLES_PER_PIXEL));
+
+		for (int j = t.y0; j < t.y1; ++j) {
+			for (int i = t.x0; i < t.x1; ++i) {
+				RT_TIME_SCOPE(PIXEL_COST[size_t(j) * IMAGE_WIDTH + i]);
+				color  pixel_color(0,0,0);
+				double mean = 0, m2 = 0; // :      
+				int    n = 0;
+
+				while (n < SAMPLES_PER_PIXEL) {
+					sampler gen = pixel_sampler(i, j, n);
+					color c = ray_color(get_ray(i, j, gen), world, gen, stats);
+					pixel_color += c;
+					++n;
+
+					double lum   = 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+					double delta = lum - mean;
+					mean += delta / n;
+					m2   += delta * (lum - mean);
+
+					if (n >= min_spp) {
+						double half_width = 1.96 * std::sqrt(m2 / (n - 1) / n);
+						if (half_width <= ADAPTIVE_TOLERANCE * std::fmax(mean, 0.01)) { break; }
+					}
+				}
+
+				fb.set(i, j, pixel_color / n);
+				PIXEL_SPP[size_t(j) * IMAGE_WIDTH + i] = n;
+				stats.max_spp = std::max(stats.max_spp, n);
+			}
+		}
+	}
+
+	/*    :  - min,  - SAMPLES_PER_PIXEL */
+	framebuffer spp_heatmap() const
+	{
+		framebuffer heat(IMAGE_WIDTH, IMAGE_HEIGHT);
+		for (int j = 0; j < IMAGE_HEIGHT; ++j) {
+			for (int i = 0; i < IMAGE_WIDTH; ++i) {
+				double x = double(PIXEL_SPP[size_t(j) * IMAGE_WIDTH + i]) / SAMPLES_PER_PIXEL;
+				heat.set(i, j, color(x, x < 0.5 ? 2*x : 2*(1 - x), 1 - x));
+			}
+		}
+		return heat;
+	}
+
+	/*
+	 *    (RT_INSTRUMENT):  -  ,  - 
+	 *  99-    (     ).
+	*/
+	framebuffer cost_heatmap() const
+	{
+		framebuffer heat(IMAGE_WIDTH, IMAGE_HEIGHT);
+		if (PIXEL_COST.empty()) { return heat; }
+
+		std::vector<float> sorted = PIXEL_COST;
+		auto p99 = sorted.begin() + std::ptrdiff_t(sorted.size() * 99 / 100);
+		std::nth_element(sorted.begin(), p99, sorted.end());
+		double scale = *p99 > 0 ? 1.0 / *p99 : 0.0;
+
+		for (int j = 0; j < IMAGE_HEIGHT; ++j) {
+			for (int i = 0; i < IMAGE_WIDTH; ++i) {
+				double x = std::fmin(1.0, PIXEL_COST[size_t(j) * IMAGE_WIDTH + i] * scale);
+				heat.set(i, j, color(x, x < 0.5 ? 2*x : 2*(1 - x), 1 - x));
+			}
+		}
+		return heat;
+	}
+
+	/*        (RT_INSTRUMENT) */
+	void report_instrumentation(const std::vector<tile>& tiles) const
+	{
+		COUNTERS.report(std::clog, material_kind_name);
+
+		if (!TILE_MS.empty()) {
+			size_t slowest = size_t(std::max_element(TILE_MS.begin(), TILE_MS.end()) - TILE_MS.begin());
+			double total = 0;
+			for (double ms : TILE_MS) { total += ms; }
+			std::clog << "Tiles: " << TILE_MS.size() << ", min " << *std::min_element(TILE_MS.begin(), TILE_MS.end())
+					  << " ms, mean " << total / TILE_MS.size() << " ms, max " << TILE_MS[slowest] << " ms at ("
+					  << tiles[slowest].x0 << ',' << tiles[slowest].y0 << ")\n";
+		}
+
+		if (!COST_HEATMAP_PATH.empty()
+			&& !write_image(COST_HEATMAP_PATH, cost_heatmap(), image_format_from_path(COST_HEATMAP_PATH))) {
+			std::cerr << "Cannot write image to " << COST_HEATMAP_PATH << '\n';
+		}
+	}
+
+	/*
+	 *  fn(tile, stats)     THREADS .  
+	 *   STATS (  COUNTERS  RT_INSTRUMENT)    , 
+	 *     .
+	*/
+	template <typename F>
+	void run_tiles(const std::vector<tile>& tiles, F&& fn)
+	{
+		std::atomic<int> remaining(int(tiles.size()));
+		std::mutex       log_lock;
+
+		run_work_stealing(tiles, THREADS, [&](const tile& t, int) {
+			render_stats tile_stats;
+#ifdef RT_INSTRUMENT
+			thread_counters() = instrument_counters();
+			auto start = std::chrono::steady_clock::now();
+#endif
+			fn(t, tile_stats);
+
+			int left = --remaining;
+			std::lock_guard<std::mutex> guard(log_lock);
+			STATS.merge(tile_stats);
+#ifdef RT_INSTRUMENT
+			COUNTERS.merge(thread_counters());
+			TILE_MS[t.index] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+#endif
+			std::clog << "\rTiles remaining: " << left << ' ' << std::flush;
+		});
+		std::clog << "\rDone.                 \n";
+	}
+
+	/*   sums  [first, first+count)    */
+	void accumulate_tile(const tile& t, const hittable& world, int first, int count, 
+		std::vector<double>& sums, render_stats& stats) const
+	{
+		for (int j = t.y0; j < t.y1; ++j) {
+			for (int i = t.x0; i < t.x1; ++i) {
+				RT_TIME_SCOPE(PIXEL_COST[size_t(j) * IMAGE_WIDTH + i]);
+				double* sum = &sums[(size_t(j) * IMAGE_WIDTH + i) * 3];
+				for (int sample = first; sample < first + count; ++sample) {
+					sampler gen = pixel_sampler(i, j, sample);
+					color c = ray_color(get_ray(i, j, gen), world, gen, stats);
+					sum[0] += c.x();
+					sum[1] += c.y();
+					sum[2] += c.z();
+				}
+			}
+		}
+	}
+
+	/*
+	 *   (PASS_SPP > 0):     
+	 *   PASS_SPP   ,     
+	 * SAMPLES_PER_PIXEL.        ,
+	 *    PREVIEW_PATH   
+	 * CHECKPOINT_PATH (. checkpoint.h).
+	 *
+	 *  RESUME == true     ,  
+	 *    , SEED, MAX_DEPTH,   
+	 *     (render_fingerprint()):   
+	 * ,   SAMPLES_PER_PIXEL,     
+	 * .    .
+	 *
+	 *        (strata_count()),
+	 *      :   
+	 *    STRATA,     ,   
+	 *       (. sampler.h).
+	*/
+	void render_progressive(const hittable& world, const std::vector<tile>& tiles)
+	{
+		accumulation_checkpoint acc;
+		bool resumed = RESUME && !CHECKPOINT_PATH.empty() && acc.load(CHECKPOINT_PATH);
+		if (RESUME && !CHECKPOINT_PATH.empty() && !resumed) {
+			std::cerr << "Checkpoint " << CHECKPOINT_PATH << " cannot be read (missing or older format), starting over\n";
+		}
+		const char* mismatch = nullptr;
+		if (resumed) {
+			if (acc.width != IMAGE_WIDTH || acc.height != IMAGE_HEIGHT) { mismatch = "image size"; }
+			else if (acc.seed != SEED)                                  { mismatch = "seed"; }
+			else if (acc.max_depth != MAX_DEPTH)                        { mismatch = "max depth"; }
+			else if (acc.shading != int32_t(SHADING))                   { mismatch = "shading mode"; }
+			else if (acc.sampler != int32_t(SAMPLER))                   { mismatch = "sampler"; }
+			else if (acc.fingerprint != render_fingerprint())           { mismatch = "scene, camera or integrator settings"; }
+		}
+		if (mismatch) {
+			std::cerr << "Checkpoint " << CHECKPOINT_PATH << " does not match the " << mismatch << ", starting over\n";
+			resumed = false;
+		}
+		int strata = STRATA;
+		if (resumed) {
+			std::clog << "Resuming from " << acc.samples << " spp\n";
+			if (SAMPLER == sampler_type::stratified && acc.strata != strata_count()) {
+				std::clog << "Stratified sampler keeps the " << acc.strata << " strata of the checkpoint\n";
+			}
+			STRATA = acc.strata;
+		}
+		else {
+			acc.width   = IMAGE_WIDTH;
+			acc.height  = IMAGE_HEIGHT;
+			acc.seed    = SEED;
+			acc.fingerprint = render_fingerprint();
+			acc.max_depth   = MAX_DEPTH;
+			acc.shading     = int32_t(SHADING);
+			acc.sampler     = int32_t(SAMPLER);
+			acc.strata      = strata_count();
+			acc.samples = 0;
+			acc.sums.assign(size_t(IMAGE_WIDTH) * IMAGE_HEIGHT * 3, 0.0);
+		}
+
+		while (acc.samples < SAMPLES_PER_PIXEL) {
+			int first = acc.samples;
+			int count = std::min(PASS_SPP, SAMPLES_PER_PIXEL - first);
+			run_tiles(tiles, [&](const tile& t, render_stats& tile_stats) {
+				accumulate_tile(t, world, first, count, acc.sums, tile_stats);
+			});
+			acc.samples += count;
+			resolve_accumulation(acc);
+
+			std::clog << "Pass done: " << acc.samples << '/' << SAMPLES_PER_PIXEL << " spp\n";
+			if (!PREVIEW_PATH.empty() && !write_image(PREVIEW_PATH, FRAME, image_format_from_path(PREVIEW_PATH, OUTPUT_FORMAT))) {
+				std::cerr << "Cannot write image to " << PREVIEW_PATH << '\n';
+			}
+			if (!CHECKPOINT_PATH.empty() && !acc.save(CHECKPOINT_PATH)) {
+				std::cerr << "Cannot write checkpoint to " << CHECKPOINT_PATH << '\n';
+			}
+		}
+		resolve_accumulation(acc);
+		STRATA = strata;
+	}
+
+	/*
+	 *  ,     ,   ,
+	 * SEED, MAX_DEPTH  SHADING (     ):
+	 *   (SCENE_FINGERPRINT), ,     real.
+	*/
+	uint64_t render_fingerprint() const
+	{
+		uint64_t h = fingerprint_bytes(&SCENE_FINGERPRINT, sizeof(SCENE_FINGERPRINT));
+		auto add = [&h](double v) { h = fingerprint_bytes(&v, sizeof(v), h); };
+		for (double v : { ASPECT_RATIO, VFOV, FOCUS_ANGLE, FOCUS_DIST, SKY_BRIGHTNESS, AO_DISTANCE, RR_THRESHOLD }) { add(v); }
+		for (int a = 0; a < 3; ++a) { add(LOOKFROM[a]); add(LOOKAT[a]); add(VUP[a]); }
+		add(LIGHT_SAMPLING ? 1 : 0);
+		add(RR_MIN_DEPTH);
+		add(double(sizeof(real)));
+		return h;
+	}
+
+	/*   -    */
+	void resolve_accumulation(const accumulation_checkpoint& acc)
+	{
+		double scale = acc.samples > 0 ? 1.0 / acc.samples : 0.0;
+		for (int j = 0; j < IMAGE_HEIGHT; ++j) {
+			for (int i = 0; i < IMAGE_WIDTH; ++i) {
+				const double* sum = &acc.sums[(size_t(j) * IMAGE_WIDTH + i) * 3];
+				FRAME.set(i, j, scale * color(sum[0], sum[1], sum[2]));
+			}
+		}
+	}
+
+	/*     : ,      */
+	struct path_state
+	{
+		ray     r;
+		color   throughput;
+		sampler gen;
+		bounce_record last;
+		int   pixel;	//    
+		int   key;		//   (  )
+	};
+
+	/*    -         */
+	static int direction_octant(const vec3& d) { return (d.x() < 0 ? 1 : 0) | (d.y() < 0 ? 2 : 0) | (d.z() < 0 ? 4 : 0); }
+
+	/*
+	 *    (RENDER_MODE == render_mode::stream).  
+	 * ray_color()           
+	 *     :
+	 *
+	 * >     PACKET_DIM x PACKET_DIM   
+	 *      world.hit_packet(), ..   ;
+	 * >       scatter(),   
+	 *           ;
+	 * > ,   ,   ,  -  ;
+	 * >     (shade())     , 
+	 *      .
+	 *
+	 *       sample_rng(),    ,  
+	 *    (  ),        
+	 *  (   ,    ).
+	*/
+	void render_tile_stream(const tile& t, const hittable& world, framebuffer& fb, render_stats& stats) const
+	{
+		int w = t.x1 - t.x0;
+		int h = t.y1 - t.y0;
+		int dim    = std::max(1, std::min(PACKET_DIM, 8));
+		int packet = dim * dim;
+
+		/*
+		 *   (     w*h ) -   : 
+		 *      ,    .
+		*/
+		static thread_local scene_arena scratch;
+		scratch.reset();
+		size_t      pixels = size_t(w) * h;
+		color*      sum    = scratch.create_array<color>(pixels);
+		path_state* paths  = scratch.create_array<path_state>(pixels);
+		path_state* next   = scratch.create_array<path_state>(pixels);
+		ray*        rays   = scratch.create_array<ray>(pixels);
+		hit_record* recs   = scratch.create_array<hit_record>(pixels);
+		bool*       hits   = scratch.create_array<bool>(pixels);
+		int*        order  = scratch.create_array<int>(pixels);
+		size_t      path_count = 0;
+		int active[MAX_PACKET_SIZE];
+#ifdef RT_INSTRUMENT
+		auto start = std::chrono::steady_clock::now();
+#endif
+
+		for (int sample = 0; sample < SAMPLES_PER_PIXEL; ++sample) {
+			/*      dim x dim */
+			path_count = 0;
+			for (int by = t.y0; by < t.y1; by += dim) {
+				for (int bx = t.x0; bx < t.x1; bx += dim) {
+					for (int j = by; j < std::min(by + dim, t.y1); ++j) {
+						for (int i = bx; i < std::min(bx + dim, t.x1); ++i) {
+							sampler gen = pixel_sampler(i, j, sample);
+							ray r = get_ray(i, j, gen);
+							paths[path_count++] = { r, color(1,1,1), gen, bounce_record(), (j - t.y0) * w + (i - t.x0), 0 };
+							++stats.paths;
+						}
+					}
+				}
+			}
+
+			for (int depth = MAX_DEPTH; depth > 0 && path_count > 0; --depth) {
+				size_t n = path_count;
+				stats.segments += n;
+				RT_COUNT(primary_rays, depth == MAX_DEPTH ? (long long)n : 0);
+				RT_COUNT(secondary_rays, depth == MAX_DEPTH ? 0 : (long long)n);
+				for (size_t k = 0; k < n; ++k) { rays[k] = paths[k].r; hits[k] = false; }
+
+				for (size_t base = 0; base < n; base += packet) {
+					int count = int(std::min(n - base, size_t(packet)));
+					for (int m = 0; m < count; ++m) { active[m] = int(base) + m; }
+					world.hit_packet(rays, active, count, interval(0, INF), recs, hits);
+				}
+
+				/*    ,     */
+				size_t order_count = 0;
+				for (size_t k = 0; k < n; ++k) {
+					if (hits[k]) { order[order_count++] = int(k); }
+					else {
+						sum[paths[k].pixel] += paths[k].throughput * background(paths[k].r);
+						RT_COUNT_PATH(MAX_DEPTH - depth + 1);
+					}
+				}
+				std::stable_sort(order, order + order_count,
+					[recs](int a, int b) { return recs[a].mat_id < recs[b].mat_id; });
+
+				size_t next_count = 0;
+				for (size_t m = 0; m < order_count; ++m) {
+					int k = order[m];
+					path_state& p = paths[k];
+					ray scattered;
+					if (shade(p.r, recs[k], world, MAX_DEPTH - depth, p.gen, p.throughput, p.last, sum[p.pixel], scattered, stats)) {
+						next[next_count++] = { scattered, p.throughput, p.gen, p.last, p.pixel, direction_octant(scattered.direction()) };
+					}
+					else { RT_COUNT_PATH(MAX_DEPTH - depth + 1); }
+				}
+				std::stable_sort(next, next + next_count, [](const path_state& a, const path_state& b) { return a.key < b.key; });
+				std::swap(paths, next);
+				path_count = next_count;
+			}
+			RT_COUNT(path_length[std::min(MAX_DEPTH, int(instrument_counters::DEPTH_BINS))], (long long)path_count);
+		}
+
+		for (int j = 0; j < h; ++j) {
+			for (int i = 0; i < w; ++i) { fb.set(t.x0 + i, t.y0 + j, PIXEL_SAMPLES_SCALE * sum[size_t(j) * w + i]); }
+		}
+
+#ifdef RT_INSTRUMENT
+		/*    ,      */
+		float pixel_cost = float(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (double(w) * h));
+		for (int j = t.y0; j < t.y1; ++j) {
+			for (int i = t.x0; i < t.x1; ++i) { PIXEL_COST[size_t(j) * IMAGE_WIDTH + i] += pixel_cost; }
+		}
+#endif
+	}
+
+	/*
+	 *      sample  (i,j):   
+	 *  PCG32,  SEED    -   .
+	*/
+	rng sample_rng(int i, int j, int sample) const
+	{
+		uint64_t pixel = uint64_t(j) * uint64_t(IMAGE_WIDTH) + uint64_t(i);
+		return rng(mix_bits(SEED ^ mix_bits(uint64_t(sample) + 1)), pixel);
+	}
+
+	/*
+	 *    sample  (i,j) (. sampler.h).  
+	 *      sample_rng()   .
+	*/
+	sampler pixel_sampler(int i, int j, int sample) const
+	{
+		uint64_t pixel = uint64_t(j) * uint64_t(IMAGE_WIDTH) + uint64_t(i);
+		return sampler(SAMPLER, mix_bits(SEED) ^ pixel, sample, strata_count(), sample_rng(i, j, sample));
+	}
+
+	/*      */
+	int strata_count() const { return STRATA > 0 ? STRATA : SAMPLES_PER_PIXEL; }
+
 	/*         ,   [-0.5,-0.5] - [0.5,0.5] */
-	vec3 sample_square() const { return vec3(random_double() - 0.5, random_double() - 0.5, 0); }
+	vec3 sample_square(sampler& gen) const 
+	{ 
+		gen.set_dimension(sampler::PIXEL_DIMENSION);
+		sample2 s = gen.get_2d();
+		return vec3(real(s.u - 0.5), real(s.v - 0.5), 0); 
+	}
 
 	/*      */
-	point3 focus_disk_sample() const 
+	point3 focus_disk_sample(sampler& gen) const 
 	{
-		vec3 lens = random_in_unit_disk();
+		gen.set_dimension(sampler::LENS_DIMENSION);
+		vec3 lens = sample_concentric_disk(gen.get_2d());
 		return CAMERA_CENTER + (lens[0] * FOCUS_DISK_U) + (lens[1] * FOCUS_DISK_V);
 	}
 
@@ -175,30 +856,131 @@ public:
 	double FOCUS_ANGLE	     = 0;				//   
 	double FOCUS_DIST		 = 10;			    //       
 
-	void render(const hittable& world)
+	int    THREADS           = 0;				//    (0 -    ).
+	int    TILE_SIZE         = 32;				//     .
+	uint64_t SEED            = 0;				//     .
+	uint64_t SCENE_FINGERPRINT = 0;				//       ( scene::load()).
+	sampler_type SAMPLER     = sampler_type::independent; //     (. sampler.h).
+	int    STRATA            = 0;				//    stratified (0 - SAMPLES_PER_PIXEL).
+
+	shading_mode SHADING     = shading_mode::path;	//  :    .
+	double AO_DISTANCE       = 1.0;				//      .
+
+	double SKY_BRIGHTNESS    = 1.0;				//    (0 -    ).
+	bool   LIGHT_SAMPLING    = true;			//      (next event estimation).
+
+	double RR_THRESHOLD      = 0.1;				//  throughput    (0 -  ).
+	int    RR_MIN_DEPTH      = 3;				//  ,    .
+
+	bool   ADAPTIVE           = false;			//    (SAMPLES_PER_PIXEL - ).
+	int    ADAPTIVE_MIN_SPP   = 16;				//       .
+	double ADAPTIVE_TOLERANCE = 0.05;			//      (95% ).
+	std::string SPP_HEATMAP_PATH = "";			//      ("" -  ).
+
+	int    PASS_SPP          = 0;				//        (0 - .).
+	std::string PREVIEW_PATH    = "";			//     .
+	std::string CHECKPOINT_PATH = "";			//     (. checkpoint.h).
+	bool   RESUME            = false;			//     .
+
+	render_mode  RENDER_MODE   = render_mode::scalar; //  :     /.
+	int          PACKET_DIM    = 8;				//      (4  8).
+
+	std::string  COST_HEATMAP_PATH = "";		//     (  RT_INSTRUMENT).
+
+	std::string  OUTPUT_PATH   = "";				//   ("" -   ).
+	image_format OUTPUT_FORMAT = image_format::ppm; //         .
+
+	/*
+	 *  render()      TILE_SIZE x TILE_SIZE 
+	 *    THREADS      .
+	 *       ,   
+	 *         OUTPUT_PATH (
+	 *   )      (. image_writer.h).
+	 *
+	 *         
+	 * (. sample_rng()),    SEED     
+	 *  ,     .
+	*/
+	void render(const hittable& world, const material_table& materials, const light_list* lights = nullptr)
+	{
+		render_frame(world, materials, lights);
+#ifdef RT_INSTRUMENT
+		auto start = std::chrono::steady_clock::now();
+#endif
+
+		if (OUTPUT_PATH.empty()) { write_image(std::cout, FRAME, OUTPUT_FORMAT); } //     > .ppm.
+		else if (!write_image(OUTPUT_PATH, FRAME, image_format_from_path(OUTPUT_PATH, OUTPUT_FORMAT))) {
+			std::cerr << "Cannot write image to " << OUTPUT_PATH << '\n';
+		}
+#ifdef RT_INSTRUMENT
+		std::clog << "Image write: " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
+#endif
+	}
+
+	/*
+	 *      (. image())   . 
+	 * lights (. light.h)    world.
+	*/
+	void render_frame(const hittable& world, const material_table& materials, const light_list* lights = nullptr)
 	{
 		initialize();
-		std::cout << "P3\n" << IMAGE_WIDTH << ' ' << IMAGE_HEIGHT << "\n255\n";
-		for (int j = 0; j < IMAGE_HEIGHT; ++j) {
-			std::clog << "\rScanlines remaining: " << (IMAGE_HEIGHT - j) << ' ' << std::flush;
-			for (int i = 0; i < IMAGE_WIDTH; ++i) {
-				color pixel_color(0,0,0);
-				/* sampling */
-				for (int sample = 0; sample < SAMPLES_PER_PIXEL; ++sample) { 
-					ray r = get_ray(i,j);	//   (i,j)   samples_per_pixel  ()
+		MATERIALS = &materials;
+		LIGHTS    = lights;
+		FRAME.resize(IMAGE_WIDTH, IMAGE_HEIGHT);
+		PIXEL_SPP.assign(size_t(IMAGE_WIDTH) * IMAGE_HEIGHT, SAMPLES_PER_PIXEL);
+		std::vector<tile> tiles = make_tiles();
 
-					/* Antialiasing */
-					pixel_color += ray_color(r, MAX_DEPTH, world); //      
-																   //  (i.j) . 
+		STATS = render_stats();
+#ifdef RT_INSTRUMENT
+		COUNTERS = instrument_counters();
+		TILE_MS.assign(tiles.size(), 0);
+		PIXEL_COST.assign(size_t(IMAGE_WIDTH) * IMAGE_HEIGHT, 0);
+#endif
+
+		if (PASS_SPP > 0) { render_progressive(world, tiles); } //   
+		else {
+			run_tiles(tiles, [&](const tile& t, render_stats& tile_stats) {
+				if (ADAPTIVE) { render_tile_adaptive(t, world, FRAME, tile_stats); } //   
+				else if (RENDER_MODE == render_mode::stream && SHADING == shading_mode::path) {
+					render_tile_stream(t, world, FRAME, tile_stats);
 				}
-				write_color(std::cout, PIXEL_SAMPLES_SCALE * pixel_color); //     > .ppm.
-																		   // pixel_color * (1.0 / SAMPLES_PER_PIXEL): 
-																		   //   pixel_color 
-																		   //     (i,j) .
+				else { render_tile(t, world, FRAME, tile_stats); }
+			});
+		}
+		if (!ADAPTIVE) { STATS.max_spp = SAMPLES_PER_PIXEL; }
+		STATS.report(std::clog);
+#ifdef RT_INSTRUMENT
+		report_instrumentation(tiles);
+#else
+		if (!COST_HEATMAP_PATH.empty()) { std::cerr << "Cost heatmap requires a build with RT_INSTRUMENT\n"; }
+#endif
+
+		if (ADAPTIVE) {
+			/*
+			 *            ,
+			 *       ,  
+			 *  ""  (max_spp).
+			*/
+			long long fixed = (long long)IMAGE_WIDTH * IMAGE_HEIGHT * STATS.max_spp;
+			long long budget = (long long)IMAGE_WIDTH * IMAGE_HEIGHT * SAMPLES_PER_PIXEL;
+			std::clog << "Adaptive: " << STATS.paths << " samples, " << double(STATS.paths) / (double(IMAGE_WIDTH) * IMAGE_HEIGHT)
+					  << " spp on average; saved " << 100.0 * (1.0 - double(STATS.paths) / fixed)
+					  << "% vs fixed " << STATS.max_spp << " spp at equal noise, "
+					  << 100.0 * (1.0 - double(STATS.paths) / budget) << "% vs " << SAMPLES_PER_PIXEL << " spp\n";
+
+			if (!SPP_HEATMAP_PATH.empty() 
+				&& !write_image(SPP_HEATMAP_PATH, spp_heatmap(), image_format_from_path(SPP_HEATMAP_PATH))) {
+				std::cerr << "Cannot write image to " << SPP_HEATMAP_PATH << '\n';
 			}
 		}
-		std::clog << "\rDone.                 \n";
 	}
+
+	/*    (i,j)    */
+	int pixel_spp(int i, int j) const { return PIXEL_SPP[size_t(j) * IMAGE_WIDTH + i]; }
+
+	const render_stats& stats() const { return STATS; }
+
+	const framebuffer& image() const { return FRAME; }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,116 @@
+/***********************************************************************************
+*   checkpoint.h    
+* :   (   ),  
+*         .
+*
+*      SEED,    
+*  (. camera::sample_rng()),    -   (SEED,
+*   ). ,    ,
+*     samples, samples+1, ...     ,
+*    .
+*
+*      ,    ,  
+*       (camera::render_fingerprint()),
+* MAX_DEPTH   :        
+*    ,    .  
+*       :  
+*   ,     (. camera::render_progressive()).
+*
+*   (little-endian):
+*     "RTCK" | version u32 | width i32 | height i32 | seed u64 | samples i32 |
+*     fingerprint u64 | max_depth i32 | shading i32 | sampler i32 | strata i32 |
+*     width*height*3 double (r,g,b ,   )
+*
+*        ,  
+*         .
+***********************************************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*   (FNV-1a, 64 ); h -    */
+const uint64_t FINGERPRINT_BASIS = 0xcbf29ce484222325ULL;
+
+inline uint64_t fingerprint_bytes(const void* data, size_t size, uint64_t h = FINGERPRINT_BASIS)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t k = 0; k < size; ++k) { h = (h ^ bytes[k]) * 0x100000001b3ULL; }
+	return h;
+}
+
+struct accumulation_checkpoint
+{
+	static const uint32_t VERSION = 3;
+
+	int32_t  width   = 0;
+	int32_t  height  = 0;
+	uint64_t seed    = 0;
+	int32_t  samples = 0;		//    ,   sums
+	uint64_t fingerprint = 0;	//  ,    
+	int32_t  max_depth   = 0;
+	int32_t  shading     = 0;	// shading_mode
+	int32_t  sampler     = 0;	// sampler_type
+	int32_t  strata      = 0;	//    stratified
+	std::vector<double> sums;	// r,g,b    
+
+	bool save(const std::string& path) const
+	{
+		std::string tmp = path + ".tmp";
+		{
+			std::ofstream out(tmp, std::ios::binary);
+			if (!out) { return false; }
+
+			uint32_t version = VERSION;
+			out.write("RTCK", 4);
+			out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+			out.write(reinterpret_cast<const char*>(&width),   sizeof(width));
+			out.write(reinterpret_cast<const char*>(&height),  sizeof(height));
+			out.write(reinterpret_cast<const char*>(&seed),    sizeof(seed));
+			out.write(reinterpret_cast<const char*>(&samples), sizeof(samples));
+			out.write(reinterpret_cast<const char*>(&fingerprint), sizeof(fingerprint));
+			out.write(reinterpret_cast<const char*>(&max_depth), sizeof(max_depth));
+			out.write(reinterpret_cast<const char*>(&shading),   sizeof(shading));
+			out.write(reinterpret_cast<const char*>(&sampler),   sizeof(sampler));
+			out.write(reinterpret_cast<const char*>(&strata),    sizeof(strata));
+			out.write(reinterpret_cast<const char*>(sums.data()), std::streamsize(sums.size() * sizeof(double)));
+			if (!out) { return false; }
+		}
+		std::remove(path.c_str()); // rename()       
+		return std::rename(tmp.c_str(), path.c_str()) == 0;
+	}
+
+	bool load(const std::string& path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		if (!in) { return false; }
+
+		char magic[4];
+		uint32_t version = 0;
+		in.read(magic, 4);
+		in.read(reinterpret_cast<char*>(&version), sizeof(version));
+		if (!in || std::string(magic, 4) != "RTCK" || version != VERSION) { return false; }
+
+		in.read(reinterpret_cast<char*>(&width),   sizeof(width));
+		in.read(reinterpret_cast<char*>(&height),  sizeof(height));
+		in.read(reinterpret_cast<char*>(&seed),    sizeof(seed));
+		in.read(reinterpret_cast<char*>(&samples), sizeof(samples));
+		in.read(reinterpret_cast<char*>(&fingerprint), sizeof(fingerprint));
+		in.read(reinterpret_cast<char*>(&max_depth), sizeof(max_depth));
+		in.read(reinterpret_cast<char*>(&shading),   sizeof(shading));
+		in.read(reinterpret_cast<char*>(&sampler),   sizeof(sampler));
+		in.read(reinterpret_cast<char*>(&strata),    sizeof(strata));
+		if (!in || width <= 0 || height <= 0 || samples < 0 || strata <= 0) { return false; }
+
+		sums.resize(size_t(width) * size_t(height) * 3);
+		in.read(reinterpret_cast<char*>(sums.data()), std::streamsize(sums.size() * sizeof(double)));
+		return bool(in);
+	}
+};
+
+#endif
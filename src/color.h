@@ -39,22 +39,17 @@ inline double liner_to_gamma(double linear_component)
 	return 0;
 }
 
-void write_color(std::ostream& out, const color& pix_color)
+/*    : -     [0,1]    [0,255] */
+inline unsigned char gamma_byte(double linear_component)
 {
-	double r = pix_color.x();
-	double g = pix_color.y();
-	double b = pix_color.z();
-
-	r = liner_to_gamma(r);
-	g = liner_to_gamma(g);
-	b = liner_to_gamma(b);
-
-	/*      [0,1]    [0,255] */
 	static const interval intensity(0.000, 0.999); // clipping
-	int rbyte = int(255.999 * intensity.clip(r));
-	int gbyte = int(255.999 * intensity.clip(g));
-	int bbyte = int(255.998 * intensity.clip(b));
+	return (unsigned char)(255.999 * intensity.clip(liner_to_gamma(linear_component)));
+}
 
-	out << rbyte << ' ' << gbyte << ' ' << bbyte << '\n';
+inline void write_color(std::ostream& out, const color& pix_color)
+{
+	out << int(gamma_byte(pix_color.x())) << ' ' 
+		<< int(gamma_byte(pix_color.y())) << ' ' 
+		<< int(gamma_byte(pix_color.z())) << '\n';
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,871 @@
+/***********************************************************************************
+*   flat_bvh.h     :
+*  (flat_node, 32 )         ,
+*     ,    ,   
+*  ,       .
+*
+* > flat_builder -      , 
+*                   (flat_ref),   :  SAH 
+*                   (binned SAH)     (LBVH),  
+*                      (refit); 
+*                     (flat_bvh),    (triangle_mesh.h);
+* > flat_bvh     -    hittable_list,  bvh_node (bvh.h);
+*                          
+*                  sphere_soa (sphere_soa.h)   (. leaf_objects).
+*
+* /  /
+*     BINS    , 
+*        S(L)*N(L) + S(R)*N(R), .. 
+* O(N)    .  -   , 
+*   .    float  
+* ,       .
+*
+*         (bvh_build::morton),
+*    ,     (), 
+*    (refit()).    
+*   SAH (flat_builder::sah_cost(), bvh_stats::sah_cost).
+*
+* /  /
+*        : 
+*  ,        , 
+*        , 
+*    .   :
+*   t   2*gamma(3),    
+* ,       (   ).
+***********************************************************************************/
+
+#ifndef FLAT_BVH_H
+#define FLAT_BVH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bvh.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "scheduler.h"
+#include "simd.h"
+#include "sphere.h"
+#include "sphere_soa.h"
+
+/*    - 32 :   float,   */
+struct flat_node
+{
+	float    lo[3], hi[3];
+	uint32_t offset;	//  -  ,   -  
+	uint16_t count;		//   , 0 -  
+	uint16_t axis;		//    ;  flat_bvh: 1 -    (leaf_objects)
+};
+static_assert(sizeof(flat_node) == 32, "flat BVH node must stay 32 bytes");
+
+/*      :      */
+typedef std::vector<flat_node, aligned_allocator<flat_node, 64>> flat_node_array;
+
+inline float round_down_float(real x) { float f = float(x); return real(f) > x ? std::nextafter(f, -float(INF)) : f; }
+inline float round_up_float(real x)   { float f = float(x); return real(f) < x ? std::nextafter(f, float(INF)) : f; }
+
+/*
+ *   :   float,  ,  .
+ *     ,    
+ * ,     .
+*/
+struct flat_ref
+{
+	float    lo[3], hi[3];
+	uint32_t index;
+
+	float centroid(int axis) const { return 0.5f * (lo[axis] + hi[axis]); }
+};
+
+inline flat_ref make_flat_ref(const aabb& box, uint32_t index)
+{
+	flat_ref r;
+	for (int a = 0; a < 3; ++a) {
+		r.lo[a] = round_down_float(box.axis_interval(a).min);
+		r.hi[a] = round_up_float(box.axis_interval(a).max);
+	}
+	r.index = index;
+	return r;
+}
+
+/*   float    ( SAH) */
+struct flat_bounds
+{
+	float  lo[3] = { float(INF), float(INF), float(INF) };
+	float  hi[3] = { -float(INF), -float(INF), -float(INF) };
+	size_t count = 0;
+
+	void grow(const float* l, const float* h)
+	{
+		for (int a = 0; a < 3; ++a) { //   fmin/fmax:   libm
+			lo[a] = l[a] < lo[a] ? l[a] : lo[a];
+			hi[a] = h[a] > hi[a] ? h[a] : hi[a];
+		}
+	}
+
+	double area() const
+	{
+		double dx = double(hi[0]) - lo[0], dy = double(hi[1]) - lo[1], dz = double(hi[2]) - lo[2];
+		return (dx < 0 || dy < 0 || dz < 0) ? 0 : 2 * (dx * dy + dy * dz + dz * dx);
+	}
+};
+
+/*    : , 1/dir    */
+struct flat_ray
+{
+	point3 origin;
+	vec3   inv_dir;
+	bool   negative[3];
+
+	flat_ray() = default;
+	explicit flat_ray(const ray& r) : origin(r.origin())
+	{
+		const vec3& d = r.direction();
+		inv_dir = vec3(1 / d.x(), 1 / d.y(), 1 / d.z());
+		for (int a = 0; a < 3; ++a) { negative[a] = d[a] < 0; }
+	}
+};
+
+/*     (.  ) */
+inline bool flat_box_hit(const flat_node& n, const flat_ray& f, interval ray_t)
+{
+	for (int axis = 0; axis < 3; ++axis) {
+		real t0 = (real(n.lo[axis]) - f.origin[axis]) * f.inv_dir[axis];
+		real t1 = (real(n.hi[axis]) - f.origin[axis]) * f.inv_dir[axis];
+		if (f.negative[axis]) { std::swap(t0, t1); }
+		t1 *= 1 + 2 * rounding_bound(3);
+		if (t0 > ray_t.min) { ray_t.min = t0; }
+		if (t1 < ray_t.max) { ray_t.max = t1; }
+		if (ray_t.max < ray_t.min) { return false; }
+	}
+	return true;
+}
+
+/*    */
+enum class bvh_build
+{
+	sah,	// SAH  :    
+	morton	// LBVH:    ,    ,   ()
+};
+
+inline const char* bvh_build_name(bvh_build mode) { return mode == bvh_build::morton ? "morton" : "sah"; }
+
+inline bool bvh_build_from_name(const std::string& name, bvh_build& mode)
+{
+	if (name == "sah")    { mode = bvh_build::sah;    return true; }
+	if (name == "morton") { mode = bvh_build::morton; return true; }
+	return false;
+}
+
+/*
+ *    nodes   refs.    
+ * max_leaf   ,      .
+ *
+ * /   /
+ *      ,    PARALLEL_BINNING
+ *      threads  ( , 
+ *   ).    task_size 
+ *   ;    run_work_stealing()
+ * (scheduler.h)   ,     nodes 
+ *    .     refs,   
+ *    ,        .
+ *
+ * / LBVH /
+ *   bvh_build::morton    10     
+ *  ,    30-  ,  
+ *     .   - ,  
+ *       (Lauterbach  ., "Fast BVH
+ * Construction on GPUs", 2009),   -   . 
+ *      .
+*/
+class flat_builder
+{
+public:
+	static const int BINS       = 16;
+	static const int SAH_DEPTH  = 64;	//  -  
+	static const int MAX_DEPTH  = SAH_DEPTH + 32;	//    2^32 
+	static const int STACK_SIZE = 128;	//     (  MAX_DEPTH)
+	static const size_t PARALLEL_BINNING = size_t(1) << 16;	//         
+	static const size_t MIN_TASK         = 1024;			//  ,   
+
+	/* threads <= 0 -     */
+	flat_builder(flat_node_array& nodes, int max_leaf, bvh_build mode = bvh_build::sah, int threads = 0)
+		: nodes(nodes), max_leaf(max_leaf), mode(mode), threads(resolve_thread_count(threads)) {}
+
+	/*    refs ( )  nodes; stats    SAH */
+	void build(std::vector<flat_ref>& refs, bvh_stats& stats)
+	{
+		nodes.clear();
+		tasks.clear();
+		codes.clear();
+		if (refs.empty()) { return; }
+		if (mode == bvh_build::morton) { sort_morton(refs); }
+
+		task_size = threads > 1 ? std::max(refs.size() / (size_t(threads) * 16), MIN_TASK) : 0;
+		if (task_size == 0) {
+			nodes.reserve(refs.size());
+			build_node(nodes, refs, 0, refs.size(), 1, stats, true);
+		}
+		else {
+			flat_node_array top;
+			build_node(top, refs, 0, refs.size(), 1, stats, true);
+
+			std::vector<size_t> order(tasks.size());
+			for (size_t k = 0; k < order.size(); ++k) { order[k] = k; }
+			std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { //   - 
+				return tasks[a].end - tasks[a].start > tasks[b].end - tasks[b].start;
+			});
+			run_work_stealing(order, threads, [&](size_t k, int) {
+				subtree& t = tasks[k];
+				t.nodes.reserve(t.end - t.start);
+				build_node(t.nodes, refs, t.start, t.end, t.depth, t.stats, false);
+			});
+
+			size_t total = top.size();
+			for (const subtree& t : tasks) {
+				total += t.nodes.size();
+				stats.nodes  += t.stats.nodes;
+				stats.leaves += t.stats.leaves;
+				stats.max_depth = std::max(stats.max_depth, t.stats.max_depth);
+			}
+			nodes.reserve(total);
+			emit(top, 0);
+			tasks.clear();
+		}
+		codes.clear();
+		codes.shrink_to_fit();
+		stats.sah_cost = sah_cost(nodes);
+	}
+
+	/*
+	 *    SAH:   ,    , 
+	 *  1         (  ,  
+	 *   ).  - ;    
+	 *    refit()  .
+	*/
+	static double sah_cost(const flat_node_array& nodes)
+	{
+		if (nodes.empty()) { return 0; }
+		auto area = [](const flat_node& n) { flat_bounds b; b.grow(n.lo, n.hi); return b.area(); };
+		double root = area(nodes[0]);
+		if (!(root > 0)) { return 0; }
+		double cost = 0;
+		for (const flat_node& n : nodes) { cost += area(n) * (n.count > 0 ? double(n.count) : 1.0); }
+		return cost / root;
+	}
+
+	/*
+	 *        (
+	 * ,      ): box(k)  flat_ref k-
+	 *    .      , 
+	 *          O(N).
+	*/
+	template <typename F>
+	static void refit(flat_node_array& nodes, F&& box)
+	{
+		for (size_t i = nodes.size(); i-- > 0;) {
+			flat_node&  n = nodes[i];
+			flat_bounds b;
+			if (n.count > 0) {
+				for (uint32_t k = n.offset; k < n.offset + n.count; ++k) {
+					flat_ref r = box(k);
+					b.grow(r.lo, r.hi);
+				}
+			}
+			else {
+				b.grow(nodes[i + 1].lo, nodes[i + 1].hi);
+				b.grow(nodes[n.offset].lo, nodes[n.offset].hi);
+			}
+			std::copy_n(b.lo, 3, n.lo);
+			std::copy_n(b.hi, 3, n.hi);
+		}
+	}
+
+private:
+	static const uint16_t DEFERRED = 0xFFFF;	// count -   (offset -  )
+
+	/*   refs[start, end)    */
+	struct subtree
+	{
+		size_t          start, end;
+		int             depth;
+		flat_node_array nodes;
+		bvh_stats       stats;
+	};
+
+	/*      */
+	struct binning
+	{
+		float lo[3];
+		float scale[3];
+		int   count;
+
+		int index(const flat_ref& r, int axis) const
+		{
+			return std::min(count - 1, int((r.centroid(axis) - lo[axis]) * scale[axis]));
+		}
+	};
+
+	flat_node_array&      nodes;
+	int                   max_leaf;
+	bvh_build             mode;
+	int                   threads;
+	size_t                task_size = 0;	// 0 -   
+	std::vector<subtree>  tasks;
+	std::vector<uint32_t> codes;			//   refs (bvh_build::morton)
+
+	/* fn(begin, end)   [start, end)    */
+	template <typename F>
+	void parallel_chunks(size_t start, size_t end, F&& fn) const
+	{
+		size_t step = (end - start + size_t(threads) - 1) / size_t(threads);
+		std::vector<size_t> chunks;
+		for (size_t b = start; b < end; b += step) { chunks.push_back(b); }
+		run_work_stealing(chunks, threads, [&](size_t b, int) { fn(b, std::min(end, b + step)); });
+	}
+
+	static void bound_range(const std::vector<flat_ref>& refs, size_t start, size_t end, flat_bounds& box, flat_bounds& centroids)
+	{
+		for (size_t i = start; i < end; ++i) {
+			const flat_ref& r = refs[i];
+			float c[3] = { r.centroid(0), r.centroid(1), r.centroid(2) };
+			box.grow(r.lo, r.hi);
+			centroids.grow(c, c);
+		}
+	}
+
+	/*      */
+	struct bin_set
+	{
+		flat_bounds bins[3][BINS];
+	};
+
+	static void bin_range(const std::vector<flat_ref>& refs, size_t start, size_t end, const binning& bins_of, bin_set& set)
+	{
+		for (size_t i = start; i < end; ++i) {
+			for (int axis = 0; axis < 3; ++axis) {
+				flat_bounds& b = set.bins[axis][bins_of.index(refs[i], axis)];
+				b.grow(refs[i].lo, refs[i].hi);
+				++b.count;
+			}
+		}
+	}
+
+	/*     ,     -   */
+	void bound(const std::vector<flat_ref>& refs, size_t start, size_t end, bool top, flat_bounds& box, flat_bounds& centroids) const
+	{
+		if (!top || threads <= 1 || end - start < PARALLEL_BINNING) { bound_range(refs, start, end, box, centroids); return; }
+		std::vector<flat_bounds> boxes(size_t(threads) * 2);
+		size_t step = (end - start + size_t(threads) - 1) / size_t(threads);
+		parallel_chunks(start, end, [&](size_t b, size_t e) {
+			size_t k = (b - start) / step;
+			bound_range(refs, b, e, boxes[2 * k], boxes[2 * k + 1]);
+		});
+		for (size_t k = 0; k < size_t(threads); ++k) {
+			box.grow(boxes[2 * k].lo, boxes[2 * k].hi);
+			centroids.grow(boxes[2 * k + 1].lo, boxes[2 * k + 1].hi);
+		}
+	}
+
+	uint32_t build_node(flat_node_array& out, std::vector<flat_ref>& refs, size_t start, size_t end, int depth, bvh_stats& stats, bool top)
+	{
+		if (top && end - start <= task_size) {
+			uint32_t index = uint32_t(out.size());
+			flat_node placeholder = flat_node();
+			placeholder.offset = uint32_t(tasks.size());
+			placeholder.count  = DEFERRED;
+			out.push_back(placeholder);
+			tasks.push_back(subtree{ start, end, depth, flat_node_array(), bvh_stats() });
+			return index;
+		}
+		return mode == bvh_build::morton ? build_morton(out, refs, start, end, depth, stats, top)
+										 : build_sah(out, refs, start, end, depth, stats, top);
+	}
+
+	/*
+	 *   SAH  refs[start, end)    .   
+	 *    BINS  (   -   ),
+	 *      k: S(L)*N(L) + S(R)*N(R).  ,
+	 *     max_leaf  count*S(P) <= S(P) + C.
+	*/
+	uint32_t build_sah(flat_node_array& out, std::vector<flat_ref>& refs, size_t start, size_t end, int depth, bvh_stats& stats, bool top)
+	{
+		uint32_t index = uint32_t(out.size());
+		out.push_back(flat_node());
+		++stats.nodes;
+		if (depth > stats.max_depth) { stats.max_depth = depth; }
+
+		flat_bounds box, centroids; //     
+		bound(refs, start, end, top, box, centroids);
+		std::copy_n(box.lo, 3, out[index].lo);
+		std::copy_n(box.hi, 3, out[index].hi);
+
+		size_t  count = end - start;
+		int     best_axis = -1, best_bin = 0;
+		double  best_cost = INF;
+		binning bins_of = { { centroids.lo[0], centroids.lo[1], centroids.lo[2] }, { 0, 0, 0 },
+							int(std::min(count, size_t(BINS))) }; //     
+
+		if (count > 1 && depth < SAH_DEPTH) {
+			bin_set set;
+			for (int axis = 0; axis < 3; ++axis) {
+				float extent = centroids.hi[axis] - centroids.lo[axis];
+				bins_of.scale[axis] = extent > 0 ? bins_of.count / extent : 0;
+			}
+			if (!top || threads <= 1 || count < PARALLEL_BINNING) { bin_range(refs, start, end, bins_of, set); }
+			else {
+				std::vector<bin_set> parts(static_cast<size_t>(threads));
+				size_t step = (count + size_t(threads) - 1) / size_t(threads);
+				parallel_chunks(start, end, [&](size_t b, size_t e) { bin_range(refs, b, e, bins_of, parts[(b - start) / step]); });
+				for (const bin_set& part : parts) {
+					for (int axis = 0; axis < 3; ++axis) {
+						for (int k = 0; k < BINS; ++k) {
+							set.bins[axis][k].grow(part.bins[axis][k].lo, part.bins[axis][k].hi);
+							set.bins[axis][k].count += part.bins[axis][k].count;
+						}
+					}
+				}
+			}
+			flat_bounds (&bins)[3][BINS] = set.bins;
+
+			for (int axis = 0; axis < 3; ++axis) {
+				if (bins_of.scale[axis] == 0) { continue; }
+
+				// right_cost[k] - S*N  [k+1, bin_count)
+				double right_cost[BINS];
+				flat_bounds right;
+				for (int k = bins_of.count - 1; k > 0; --k) {
+					right.grow(bins[axis][k].lo, bins[axis][k].hi);
+					right.count += bins[axis][k].count;
+					right_cost[k - 1] = right.area() * double(right.count);
+				}
+
+				flat_bounds left;
+				for (int k = 0; k < bins_of.count - 1; ++k) {
+					left.grow(bins[axis][k].lo, bins[axis][k].hi);
+					left.count += bins[axis][k].count;
+					if (left.count == 0 || left.count == count) { continue; }
+					double cost = left.area() * double(left.count) + right_cost[k];
+					if (cost < best_cost) { best_cost = cost; best_axis = axis; best_bin = k; }
+				}
+			}
+		}
+
+		double area = box.area();
+		if (count == 1 || (count <= size_t(max_leaf) && double(count) * area <= area + best_cost)) {
+			out[index].offset = uint32_t(start);
+			out[index].count  = uint16_t(count);
+			++stats.leaves;
+			return index;
+		}
+
+		size_t mid = start;
+		if (best_axis >= 0) {
+			int axis = best_axis;
+			mid = size_t(std::partition(refs.begin() + start, refs.begin() + end,
+				[&](const flat_ref& r) { return bins_of.index(r, axis) <= best_bin; }) - refs.begin());
+		}
+		if (mid == start || mid == end) {
+			//     :      
+			float ex = centroids.hi[0] - centroids.lo[0], ey = centroids.hi[1] - centroids.lo[1], ez = centroids.hi[2] - centroids.lo[2];
+			best_axis = (ex > ey) ? (ex > ez ? 0 : 2) : (ey > ez ? 1 : 2);
+			int axis = best_axis;
+			mid = start + count / 2;
+			std::nth_element(refs.begin() + start, refs.begin() + mid, refs.begin() + end,
+				[axis](const flat_ref& a, const flat_ref& b) { return a.centroid(axis) < b.centroid(axis); });
+		}
+
+		build_node(out, refs, start, mid, depth + 1, stats, top);
+		uint32_t right_child = build_node(out, refs, mid, end, depth + 1, stats, top);
+		out[index].offset = right_child;
+		out[index].count  = 0;
+		out[index].axis   = uint16_t(best_axis);
+		return index;
+	}
+
+	/*  LBVH  refs[start, end),     codes */
+	uint32_t build_morton(flat_node_array& out, std::vector<flat_ref>& refs, size_t start, size_t end, int depth, bvh_stats& stats, bool top)
+	{
+		uint32_t index = uint32_t(out.size());
+		out.push_back(flat_node());
+		++stats.nodes;
+		if (depth > stats.max_depth) { stats.max_depth = depth; }
+
+		size_t count = end - start;
+		if (count <= size_t(max_leaf)) {
+			flat_bounds box;
+			for (size_t i = start; i < end; ++i) { box.grow(refs[i].lo, refs[i].hi); }
+			std::copy_n(box.lo, 3, out[index].lo);
+			std::copy_n(box.hi, 3, out[index].hi);
+			out[index].offset = uint32_t(start);
+			out[index].count  = uint16_t(count);
+			++stats.leaves;
+			return index;
+		}
+
+		size_t   mid  = start + count / 2; //  :  
+		uint16_t axis = 0;
+		uint32_t diff = codes[start] ^ codes[end - 1];
+		if (diff != 0) {
+			int bit = 31;
+			while (!(diff >> bit)) { --bit; }
+			mid = size_t(std::partition_point(codes.begin() + start, codes.begin() + end,
+				[bit](uint32_t c) { return ((c >> bit) & 1) == 0; }) - codes.begin());
+			axis = uint16_t(2 - bit % 3);
+		}
+
+		build_node(out, refs, start, mid, depth + 1, stats, top);
+		uint32_t right_child = build_node(out, refs, mid, end, depth + 1, stats, top);
+		flat_node& n = out[index];
+		flat_bounds box; //       emit()
+		box.grow(out[index + 1].lo, out[index + 1].hi);
+		box.grow(out[right_child].lo, out[right_child].hi);
+		std::copy_n(box.lo, 3, n.lo);
+		std::copy_n(box.hi, 3, n.hi);
+		n.offset = right_child;
+		n.count  = 0;
+		n.axis   = axis;
+		return index;
+	}
+
+	/*   v (10 )  : bit k -> bit 3k */
+	static uint32_t spread_bits(uint32_t v)
+	{
+		v = (v | (v << 16)) & 0x030000FF;
+		v = (v | (v << 8))  & 0x0300F00F;
+		v = (v | (v << 4))  & 0x030C30C3;
+		v = (v | (v << 2))  & 0x09249249;
+		return v;
+	}
+
+	/*       refs   (4   8 ) */
+	void sort_morton(std::vector<flat_ref>& refs)
+	{
+		size_t n = refs.size();
+		flat_bounds box, centroids;
+		bound(refs, 0, n, true, box, centroids);
+		float scale[3];
+		for (int a = 0; a < 3; ++a) {
+			float extent = centroids.hi[a] - centroids.lo[a];
+			scale[a] = extent > 0 ? 1024 / extent : 0;
+		}
+
+		std::vector<uint64_t> keys(n), sorted(n); //    32 ,  -  
+		auto encode = [&](size_t b, size_t e) {
+			for (size_t i = b; i < e; ++i) {
+				uint32_t q[3];
+				for (int a = 0; a < 3; ++a) {
+					q[a] = uint32_t(std::min(1023, int((refs[i].centroid(a) - centroids.lo[a]) * scale[a])));
+				}
+				uint32_t code = (spread_bits(q[0]) << 2) | (spread_bits(q[1]) << 1) | spread_bits(q[2]);
+				keys[i] = (uint64_t(code) << 32) | i;
+			}
+		};
+		if (threads > 1 && n >= PARALLEL_BINNING) { parallel_chunks(0, n, encode); }
+		else { encode(0, n); }
+
+		for (int shift = 32; shift < 64; shift += 8) {
+			size_t histogram[257] = {};
+			for (uint64_t k : keys) { ++histogram[((k >> shift) & 0xFF) + 1]; }
+			for (int b = 0; b < 256; ++b) { histogram[b + 1] += histogram[b]; }
+			for (uint64_t k : keys) { sorted[histogram[(k >> shift) & 0xFF]++] = k; }
+			keys.swap(sorted);
+		}
+
+		std::vector<flat_ref> ordered(n);
+		codes.resize(n);
+		for (size_t i = 0; i < n; ++i) {
+			ordered[i] = refs[size_t(keys[i] & 0xFFFFFFFFu)];
+			codes[i]   = uint32_t(keys[i] >> 32);
+		}
+		refs.swap(ordered);
+	}
+
+	/*
+	 *    top     nodes    
+	 * ;      .
+	*/
+	uint32_t emit(const flat_node_array& top, uint32_t index)
+	{
+		const flat_node& n = top[index];
+		uint32_t at = uint32_t(nodes.size());
+		if (n.count == DEFERRED) {
+			for (flat_node m : tasks[n.offset].nodes) {
+				if (m.count == 0) { m.offset += at; }
+				nodes.push_back(m);
+			}
+			tasks[n.offset].nodes = flat_node_array();
+			return at;
+		}
+		nodes.push_back(n);
+		if (n.count == 0) {
+			emit(top, index + 1);
+			uint32_t right_child = emit(top, n.offset);
+			flat_bounds box;
+			box.grow(nodes[at + 1].lo, nodes[at + 1].hi);
+			box.grow(nodes[right_child].lo, nodes[right_child].hi);
+			std::copy_n(box.lo, 3, nodes[at].lo);
+			std::copy_n(box.hi, 3, nodes[at].hi);
+			nodes[at].offset = right_child;
+		}
+		return at;
+	}
+};
+
+/*
+ *     (flat_bvh, wide_bvh.h)   . 
+ * (sphere.h)     spheres     (  
+ *  -  ),  ,    - , 
+ *  sphere_soa::hit_range()     
+ *   hit()   .
+*/
+struct leaf_objects
+{
+	std::vector<shared_ptr<hittable>> objects;
+	sphere_soa spheres;	// ,     
+
+	/*     spheres (   ); false,    */
+	bool gather_spheres()
+	{
+		spheres.clear();
+		bool any = std::any_of(objects.begin(), objects.end(),
+			[](const shared_ptr<hittable>& object) { return dynamic_cast<const sphere*>(object.get()) != nullptr; });
+		if (!any) { return false; }
+		for (const shared_ptr<hittable>& object : objects) {
+			if (const sphere* s = dynamic_cast<const sphere*>(object.get())) { spheres.add(*s); }
+			else { spheres.add_empty(); }
+		}
+		return true;
+	}
+
+	bool all_spheres(uint32_t first, uint32_t count) const
+	{
+		for (uint32_t k = first; k < first + count; ++k) {
+			if (!dynamic_cast<const sphere*>(objects[k].get())) { return false; }
+		}
+		return true;
+	}
+
+	/*      [first, first+count); soa -     */
+	bool hit(const ray& r, interval ray_t, hit_record& rec, uint32_t first, uint32_t count, bool soa) const
+	{
+		if (soa) { return spheres.hit_range(r, ray_t, rec, first, count); }
+		bool hit_anything = false;
+		for (uint32_t k = first; k < first + count; ++k) {
+			if (objects[k]->hit(r, ray_t, rec)) {
+				hit_anything = true;
+				ray_t.max = rec.t;
+			}
+		}
+		return hit_anything;
+	}
+
+	bool occluded(const ray& r, interval ray_t, uint32_t first, uint32_t count, bool soa) const
+	{
+		if (soa) { return spheres.occluded_range(r, ray_t, first, count); }
+		for (uint32_t k = first; k < first + count; ++k) {
+			if (objects[k]->occluded(r, ray_t)) { return true; }
+		}
+		return false;
+	}
+
+	size_t memory_bytes() const { return objects.capacity() * sizeof(shared_ptr<hittable>) + spheres.memory_bytes(); }
+};
+
+class flat_bvh : public hittable
+{
+public:
+	static const int MAX_LEAF = 4;
+
+	/*
+	 *     list (    ).
+	 *         .
+	*/
+	explicit flat_bvh(const hittable_list& list, bvh_stats* stats = nullptr, bvh_build mode = bvh_build::sah, int threads = 0)
+	{
+		auto start = std::chrono::steady_clock::now();
+		build_hierarchy(list, nodes, leaves, build_info, mode, threads);
+		build_info.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (stats) { *stats = build_info; }
+		bbox = nodes.empty() ? aabb() : node_box(nodes[0]);
+	}
+
+	/*
+	 *    nodes   list,    leaves 
+	 *         (  wide_bvh.h).
+	*/
+	static void build_hierarchy(const hittable_list& list, flat_node_array& nodes, leaf_objects& leaves,
+		bvh_stats& stats, bvh_build mode = bvh_build::sah, int threads = 0)
+	{
+		stats = bvh_stats();
+		nodes.clear();
+		leaves.objects.clear();
+		leaves.spheres.clear();
+
+		std::vector<flat_ref> refs;
+		refs.reserve(list.objects.size());
+		for (size_t k = 0; k < list.objects.size(); ++k) {
+			aabb box = list.objects[k]->bounding_box();
+			if (box.x.size() < 0 || box.y.size() < 0 || box.z.size() < 0) { continue; }
+			refs.push_back(make_flat_ref(box, uint32_t(k)));
+		}
+		if (refs.empty()) { return; }
+
+		flat_builder(nodes, MAX_LEAF, mode, threads).build(refs, stats);
+		if (nodes.capacity() > nodes.size() + nodes.size() / 4) { nodes.shrink_to_fit(); }
+
+		leaves.objects.reserve(refs.size());
+		for (const flat_ref& r : refs) { leaves.objects.push_back(list.objects[r.index]); }
+		if (!leaves.gather_spheres()) { return; }
+		for (flat_node& n : nodes) {
+			if (n.count > 0) { n.axis = leaves.all_spheres(n.offset, n.count) ? 1 : 0; }
+		}
+	}
+
+	static aabb node_box(const flat_node& n)
+	{
+		return aabb(interval(n.lo[0], n.hi[0]), interval(n.lo[1], n.hi[1]), interval(n.lo[2], n.hi[2]));
+	}
+
+	/*
+	 *       ( 
+	 * ); build_ms  sah_cost  hierarchy_stats() -    
+	 *  .
+	*/
+	void refit(bvh_stats* stats = nullptr)
+	{
+		if (nodes.empty()) { return; }
+		auto start = std::chrono::steady_clock::now();
+		flat_builder::refit(nodes, [&](uint32_t k) { return make_flat_ref(leaves.objects[k]->bounding_box(), k); });
+		leaves.gather_spheres();
+		build_info.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		build_info.sah_cost = flat_builder::sah_cost(nodes);
+		if (stats) { *stats = build_info; }
+		bbox = node_box(nodes[0]);
+	}
+
+	const bvh_stats& hierarchy_stats() const { return build_info; }
+	size_t memory_bytes() const { return nodes.capacity() * sizeof(flat_node) + leaves.memory_bytes(); }
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		if (nodes.empty()) { return false; }
+		flat_ray f(r);
+		uint32_t stack[flat_builder::STACK_SIZE];
+		int      top = 0;
+		uint32_t current = 0;
+		bool     hit_anything = false;
+
+		for (;;) {
+			RT_COUNT(node_tests, 1);
+			const flat_node& n = nodes[current];
+			if (flat_box_hit(n, f, ray_t)) {
+				if (n.count == 0) {
+					uint32_t near_child = current + 1, far_child = n.offset;
+					if (f.negative[n.axis]) { std::swap(near_child, far_child); }
+					stack[top++] = far_child;
+					current = near_child;
+					continue;
+				}
+				if (leaves.hit(r, ray_t, rec, n.offset, n.count, n.axis != 0)) {
+					hit_anything = true;
+					ray_t.max = rec.t;
+				}
+			}
+			if (top == 0) { break; }
+			current = stack[--top];
+		}
+		return hit_anything;
+	}
+
+	bool occluded(const ray& r, interval ray_t) const override
+	{
+		if (nodes.empty()) { return false; }
+		flat_ray f(r);
+		uint32_t stack[flat_builder::STACK_SIZE];
+		int      top = 0;
+		uint32_t current = 0;
+
+		for (;;) {
+			RT_COUNT(node_tests, 1);
+			const flat_node& n = nodes[current];
+			if (flat_box_hit(n, f, ray_t)) {
+				if (n.count == 0) {
+					stack[top++] = n.offset;
+					current = current + 1;
+					continue;
+				}
+				if (leaves.occluded(r, ray_t, n.offset, n.count, n.axis != 0)) { return true; }
+			}
+			if (top == 0) { return false; }
+			current = stack[--top];
+		}
+	}
+
+	/*
+	 *   ( bvh_node::hit_packet()),      :
+	 *   -     ,   . 
+	 *      ,     
+	 *  ;        .
+	*/
+	void hit_packet(const ray* rays, const int* active, int count, interval ray_t,
+		hit_record* recs, bool* hits) const override
+	{
+		if (nodes.empty() || count <= 0) { return; }
+		if (count == 1) {
+			int k = active[0];
+			if (hit(rays[k], interval(ray_t.min, hits[k] ? recs[k].t : ray_t.max), recs[k])) { hits[k] = true; }
+			return;
+		}
+
+		flat_ray frames[MAX_PACKET_SIZE];
+		for (int m = 0; m < count; ++m) { frames[m] = flat_ray(rays[active[m]]); }
+		struct entry { uint32_t node; packet_mask mask; };
+		entry       stack[flat_builder::STACK_SIZE];
+		int         top = 0;
+		uint32_t    current = 0;
+		packet_mask live = packet_all(count);
+
+		for (;;) {
+			const flat_node& n = nodes[current];
+			packet_mask inside = 0;
+			for (packet_mask rest = live; rest != 0; rest &= rest - 1) {
+				RT_COUNT(node_tests, 1);
+				int m = packet_first(rest), k = active[m];
+				if (flat_box_hit(n, frames[m], interval(ray_t.min, hits[k] ? recs[k].t : ray_t.max))) { inside |= packet_mask(1) << m; }
+			}
+			if (inside != 0) {
+				if (n.count == 0) {
+					uint32_t near_child = current + 1, far_child = n.offset;
+					if (frames[packet_first(inside)].negative[n.axis]) { std::swap(near_child, far_child); }
+					stack[top++] = { far_child, inside };
+					current = near_child;
+					live    = inside;
+					continue;
+				}
+				for (packet_mask rest = inside; rest != 0; rest &= rest - 1) {
+					int k = active[packet_first(rest)];
+					if (leaves.hit(rays[k], interval(ray_t.min, hits[k] ? recs[k].t : ray_t.max), recs[k], n.offset, n.count, n.axis != 0)) { hits[k] = true; }
+				}
+			}
+			if (top == 0) { break; }
+			--top;
+			current = stack[top].node;
+			live    = stack[top].mask;
+		}
+	}
+
+	aabb bounding_box() const override { return bbox; }
+
+private:
+	flat_node_array nodes;
+	leaf_objects    leaves;
+	aabb      bbox;
+	bvh_stats build_info;
+};
+
+#endif
@@ -0,0 +1,54 @@
+/***********************************************************************************
+*   framebuffer.h    -   ,
+*    .
+*
+*       ( -)  
+*  float  ,     . -   
+*          8   
+* (. image_writer.h),   PFM    .
+***********************************************************************************/
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <vector>
+
+class framebuffer
+{
+private:
+	int width  = 0;
+	int height = 0;
+	std::vector<float> data; // r,g,b   
+public:
+	framebuffer() {}
+	framebuffer(int width, int height) { resize(width, height); }
+
+	void resize(int w, int h)
+	{
+		width  = w;
+		height = h;
+		data.assign(size_t(w) * size_t(h) * 3, 0.0f);
+	}
+
+	int get_width()  const { return width; }
+	int get_height() const { return height; }
+
+	const float* pixels() const { return data.data(); }
+	const float* row(int j) const { return data.data() + size_t(j) * width * 3; }
+
+	void set(int i, int j, const color& c)
+	{
+		float* p = data.data() + (size_t(j) * width + i) * 3;
+		p[0] = float(c.x());
+		p[1] = float(c.y());
+		p[2] = float(c.z());
+	}
+
+	color get(int i, int j) const
+	{
+		const float* p = data.data() + (size_t(j) * width + i) * 3;
+		return color(p[0], p[1], p[2]);
+	}
+};
+
+#endif
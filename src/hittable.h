@@ -1,17 +1,24 @@
 #ifndef HITTABLE_H
 #define HITTABLE_H
 
-class material;
+#include "aabb.h"
+#include "instrument.h"
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
 
 class hit_record {
 public:
 	point3 p;
 	vec3 normal;
-	shared_ptr<material> mat; //     ,  
-							  //    (scatter()).  ray_color() 
-							  // ,     
-							  //      .
-	double t;
+	uint32_t mat_id;	//       (material_table), 
+						//  ray_color() ,    
+						//       .   
+						//   ,    shared_ptr.
+	real t;
+	real error = 0;		//     p (. spawn_ray())
+	real u = 0, v = 0;	//   (. triangle_mesh.h),   - 0
 	bool front_face;
 
 	/*
@@ -35,12 +42,96 @@ public:
 		front_face = dot(r.direction(), outward_normal) < 0;
 		normal = front_face ? outward_normal : -outward_normal;
 	}
+
+	/*
+	 *  spawn_ray()        dir.
+	 *
+	 *   p     ,    error  ,
+	 *  ,    p,      
+	 * ("").      t > 0.001, 
+	 *          float   .
+	 *          ( 
+	 * dir:   ,   ),     
+	 *     ,     t > 0.
+	*/
+	ray spawn_ray(const vec3& dir) const
+	{
+		real d = error * (std::fabs(normal.x()) + std::fabs(normal.y()) + std::fabs(normal.z()));
+		vec3 offset = d * normal;
+		if (dot(dir, normal) < 0) { offset = -offset; }
+		return ray(p + offset, dir);
+	}
 };
 
+/*
+ *     n   
+ * : n*u / (1 - n*u),  u -     real.
+*/
+inline constexpr real rounding_bound(int n)
+{
+	return (n * std::numeric_limits<real>::epsilon() / 2) / (1 - n * std::numeric_limits<real>::epsilon() / 2);
+}
+
+/*      (. hittable::hit_packet()) */
+const int MAX_PACKET_SIZE = 64;
+
+/*      :  m -  active[m] */
+typedef uint64_t packet_mask;
+static_assert(MAX_PACKET_SIZE <= 64, "packet mask holds one bit per packet ray");
+
+inline packet_mask packet_all(int count) { return count >= 64 ? ~packet_mask(0) : (packet_mask(1) << count) - 1; }
+
+/*      :        */
+inline int packet_first(packet_mask mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(mask);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long k;
+	_BitScanForward64(&k, mask);
+	return int(k);
+#else
+	int k = 0;
+	while (!(mask & 1)) { mask >>= 1; ++k; }
+	return k;
+#endif
+}
+
 class hittable {
 public:
 	virtual ~hittable() = default;
 	virtual bool hit(const ray& r, interval ray_t,hit_record& rec) const = 0;
+
+	/*
+	 *  :    rays[active[0..count)]  .
+	 *    k,    (hits[k] == true),  
+	 *   recs[k].t,      
+	 *   ,   hit().      ,
+	 *    ,     
+	 *  (count <= MAX_PACKET_SIZE).
+	*/
+	virtual void hit_packet(const ray* rays, const int* active, int count, interval ray_t,
+		hit_record* recs, bool* hits) const
+	{
+		for (int n = 0; n < count; ++n) {
+			int k = active[n];
+			if (hit(rays[k], interval(ray_t.min, hits[k] ? recs[k].t : ray_t.max), recs[k])) { hits[k] = true; }
+		}
+	}
+
+	/*
+	 *   (any-hit): true,     -  ray_t.
+	 *       ,    , 
+	 *    ,      
+	 * .   -     hit().
+	*/
+	virtual bool occluded(const ray& r, interval ray_t) const
+	{
+		hit_record rec;
+		return hit(r, ray_t, rec);
+	}
+
+	virtual aabb bounding_box() const = 0; //    (. aabb.h)
 };
 
 #endif
\ No newline at end of file
@@ -11,8 +11,12 @@ public:
 	hittable_list() {}
 	hittable_list(shared_ptr<hittable> object) { add(object); }
 
-	void add(shared_ptr<hittable> object) { objects.push_back(object); }
-	void clear() { objects.clear(); }
+	void add(shared_ptr<hittable> object) 
+	{ 
+		objects.push_back(object); 
+		bbox = aabb(bbox, object->bounding_box());
+	}
+	void clear() { objects.clear(); bbox = aabb(); }
 
 	/*
 	 *  hit()      hittable  objects,
@@ -42,6 +46,26 @@ public:
 		}
 		return hit_anything;
 	}
+
+	void hit_packet(const ray* rays, const int* active, int count, interval ray_t,
+		hit_record* recs, bool* hits) const override
+	{
+		for (const shared_ptr<hittable>& object : objects) { object->hit_packet(rays, active, count, ray_t, recs, hits); }
+	}
+
+	/*     ,    */
+	bool occluded(const ray& r, interval ray_t) const override
+	{
+		for (const shared_ptr<hittable>& object : objects) {
+			if (object->occluded(r, ray_t)) { return true; }
+		}
+		return false;
+	}
+
+	aabb bounding_box() const override { return bbox; }
+
+private:
+	aabb bbox;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,112 @@
+/***********************************************************************************
+*   image_diff.h    PFM (. image_writer.h)
+*       .
+*
+*    ,     ,
+*  double  float (RT_FLOAT):      - ,
+*     ,    (RMSE)
+*   ,       .
+*
+* ray-tracing --diff a.pfm b.pfm [--tolerance RMSE]
+***********************************************************************************/
+
+#ifndef IMAGE_DIFF_H
+#define IMAGE_DIFF_H
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "framebuffer.h"
+
+/*
+ *   PFM (, "PF")  fb.   little-endian 
+ * ( ),   encode_pfm().    
+ *  ,  fb -  .    false    error.
+*/
+inline bool read_pfm(const std::string& path, framebuffer& fb, std::string& error)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) { error = "Cannot open " + path; return false; }
+	std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	/*  -   : "PF",   ,  */
+	size_t pos = 0;
+	std::string lines[3];
+	for (std::string& line : lines) {
+		size_t end = pos;
+		while (end < data.size() && data[end] != '\n') { ++end; }
+		if (end == data.size()) { error = path + ": truncated PFM header"; return false; }
+		line.assign(data.data() + pos, end - pos);
+		pos = end + 1;
+	}
+
+	int    width = 0, height = 0;
+	double scale = 0;
+	std::istringstream size_line(lines[1]), scale_line(lines[2]);
+	if (lines[0] != "PF" || !(size_line >> width >> height) || !(scale_line >> scale) || width <= 0 || height <= 0) {
+		error = path + ": not a color PFM file";
+		return false;
+	}
+	if (scale >= 0) { error = path + ": big-endian PFM is not supported"; return false; }
+
+	size_t row_floats = size_t(width) * 3;
+	if (data.size() - pos < row_floats * height * sizeof(float)) { error = path + ": truncated PFM data"; return false; }
+
+	fb.resize(width, height);
+	std::vector<float> row(row_floats);
+	for (int j = height - 1; j >= 0; --j) {
+		std::memcpy(row.data(), data.data() + pos, row_floats * sizeof(float));
+		pos += row_floats * sizeof(float);
+		for (int i = 0; i < width; ++i) { fb.set(i, j, color(row[3*i], row[3*i + 1], row[3*i + 2])); }
+	}
+	return true;
+}
+
+/*       r,g,b   */
+struct image_difference
+{
+	double rmse       = 0;	//  
+	double mean_abs   = 0;	//   
+	double max_abs    = 0;	//   
+	double mean_a     = 0;	//    ( )
+	double mean_b     = 0;
+
+	void report(std::ostream& out) const
+	{
+		out << "RMSE " << rmse << ", mean |a-b| " << mean_abs << ", max |a-b| " << max_abs
+			<< ", mean a " << mean_a << ", mean b " << mean_b << '\n';
+	}
+};
+
+/*     */
+inline image_difference compare_images(const framebuffer& a, const framebuffer& b)
+{
+	image_difference res;
+	size_t count = size_t(a.get_width()) * a.get_height() * 3;
+	if (count == 0) { return res; }
+
+	const float* pa = a.pixels();
+	const float* pb = b.pixels();
+	double sum_sq = 0, sum_abs = 0, sum_a = 0, sum_b = 0;
+	for (size_t k = 0; k < count; ++k) {
+		double d = std::fabs(double(pa[k]) - double(pb[k]));
+		sum_sq  += d * d;
+		sum_abs += d;
+		sum_a   += pa[k];
+		sum_b   += pb[k];
+		if (d > res.max_abs) { res.max_abs = d; }
+	}
+	res.rmse     = std::sqrt(sum_sq / count);
+	res.mean_abs = sum_abs / count;
+	res.mean_a   = sum_a / count;
+	res.mean_b   = sum_b / count;
+	return res;
+}
+
+#endif
@@ -0,0 +1,198 @@
+/***********************************************************************************
+*   image_writer.h     (framebuffer.h)
+*        :
+*
+* > P6  -  PPM,  3     -.   
+*          P3       ~4  .
+* > PFM - Portable Float Map,   float   (HDR).  
+*         PFM   ,    little-endian.
+* > PNG - 8- RGB PNG.   :   ""
+*         (stored)  deflate,    zlib,   
+*           .
+*
+*          write().
+***********************************************************************************/
+
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "framebuffer.h"
+
+enum class image_format { ppm, pfm, png };
+
+/*     ,     fallback */
+inline image_format image_format_from_path(const std::string& path, image_format fallback = image_format::ppm)
+{
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos) { return fallback; }
+	std::string ext = path.substr(dot + 1);
+	for (char& c : ext) { c = char(std::tolower((unsigned char)c)); }
+
+	if (ext == "ppm") { return image_format::ppm; }
+	if (ext == "pfm") { return image_format::pfm; }
+	if (ext == "png") { return image_format::png; }
+	return fallback;
+}
+
+namespace image_detail
+{
+	inline void append(std::vector<char>& buf, const std::string& s) { buf.insert(buf.end(), s.begin(), s.end()); }
+
+	inline void append_be32(std::vector<char>& buf, uint32_t v)
+	{
+		buf.push_back(char(v >> 24));
+		buf.push_back(char(v >> 16));
+		buf.push_back(char(v >> 8));
+		buf.push_back(char(v));
+	}
+
+	inline std::vector<uint32_t> make_crc_table()
+	{
+		std::vector<uint32_t> table(256);
+		for (uint32_t n = 0; n < 256; ++n) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; ++k) { c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1; }
+			table[n] = c;
+		}
+		return table;
+	}
+
+	inline uint32_t crc32(const char* data, size_t size, uint32_t crc = 0)
+	{
+		static const std::vector<uint32_t> table = make_crc_table();
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i) { crc = table[(crc ^ (unsigned char)data[i]) & 0xff] ^ (crc >> 8); }
+		return ~crc;
+	}
+
+	inline uint32_t adler32(const std::vector<char>& data)
+	{
+		uint32_t a = 1, b = 0;
+		for (char c : data) {
+			a = (a + (unsigned char)c) % 65521;
+			b = (b + a) % 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	//  PNG: , ,   CRC    .
+	inline void append_png_chunk(std::vector<char>& buf, const char* type, const std::vector<char>& data)
+	{
+		append_be32(buf, uint32_t(data.size()));
+		size_t start = buf.size();
+		buf.insert(buf.end(), type, type + 4);
+		buf.insert(buf.end(), data.begin(), data.end());
+		append_be32(buf, crc32(buf.data() + start, buf.size() - start));
+	}
+}
+
+inline std::vector<char> encode_ppm(const framebuffer& fb)
+{
+	std::vector<char> buf;
+	image_detail::append(buf, "P6\n" + std::to_string(fb.get_width()) + ' ' + std::to_string(fb.get_height()) + "\n255\n");
+
+	size_t count = size_t(fb.get_width()) * fb.get_height() * 3;
+	size_t start = buf.size();
+	buf.resize(start + count);
+	const float* p = fb.pixels();
+	for (size_t k = 0; k < count; ++k) { buf[start + k] = char(gamma_byte(p[k])); }
+	return buf;
+}
+
+inline std::vector<char> encode_pfm(const framebuffer& fb)
+{
+	std::vector<char> buf;
+	image_detail::append(buf, "PF\n" + std::to_string(fb.get_width()) + ' ' + std::to_string(fb.get_height()) + "\n-1.0\n");
+
+	size_t row_bytes = size_t(fb.get_width()) * 3 * sizeof(float);
+	for (int j = fb.get_height() - 1; j >= 0; --j) {
+		const char* row = reinterpret_cast<const char*>(fb.row(j));
+		buf.insert(buf.end(), row, row + row_bytes); //  little-endian 
+	}
+	return buf;
+}
+
+inline std::vector<char> encode_png(const framebuffer& fb)
+{
+	int w = fb.get_width();
+	int h = fb.get_height();
+
+	/*  :   (0 -  )  RGB  */
+	std::vector<char> raw;
+	raw.reserve(size_t(h) * (size_t(w) * 3 + 1));
+	for (int j = 0; j < h; ++j) {
+		raw.push_back(0);
+		const float* p = fb.row(j);
+		for (int k = 0; k < w * 3; ++k) { raw.push_back(char(gamma_byte(p[k]))); }
+	}
+
+	/*  zlib    deflate    65535  */
+	std::vector<char> idat;
+	idat.push_back(0x78);
+	idat.push_back(0x01);
+	size_t pos = 0;
+	do {
+		size_t len   = std::min<size_t>(65535, raw.size() - pos);
+		bool   final = (pos + len == raw.size());
+		idat.push_back(final ? 1 : 0);
+		idat.push_back(char(len & 0xff));
+		idat.push_back(char(len >> 8));
+		idat.push_back(char(~len & 0xff));
+		idat.push_back(char((~len >> 8) & 0xff));
+		idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + len);
+		pos += len;
+	} while (pos < raw.size());
+	image_detail::append_be32(idat, image_detail::adler32(raw));
+
+	std::vector<char> ihdr;
+	image_detail::append_be32(ihdr, uint32_t(w));
+	image_detail::append_be32(ihdr, uint32_t(h));
+	ihdr.push_back(8); //   
+	ihdr.push_back(2); //  : RGB
+	ihdr.push_back(0); //  deflate
+	ihdr.push_back(0); //  
+	ihdr.push_back(0); //  
+
+	std::vector<char> buf;
+	const char signature[8] = { char(0x89), 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	buf.insert(buf.end(), signature, signature + 8);
+	image_detail::append_png_chunk(buf, "IHDR", ihdr);
+	image_detail::append_png_chunk(buf, "IDAT", idat);
+	image_detail::append_png_chunk(buf, "IEND", std::vector<char>());
+	return buf;
+}
+
+inline std::vector<char> encode_image(const framebuffer& fb, image_format format)
+{
+	switch (format) {
+	case image_format::pfm: return encode_pfm(fb);
+	case image_format::png: return encode_png(fb);
+	default:                return encode_ppm(fb);
+	}
+}
+
+/*       */
+inline void write_image(std::ostream& out, const framebuffer& fb, image_format format)
+{
+	std::vector<char> buf = encode_image(fb, format);
+	out.write(buf.data(), std::streamsize(buf.size()));
+	out.flush();
+}
+
+/*     path,  false      */
+inline bool write_image(const std::string& path, const framebuffer& fb, image_format format)
+{
+	std::ofstream out(path, std::ios::binary);
+	if (!out) { return false; }
+	write_image(out, fb, format);
+	return bool(out);
+}
+
+#endif
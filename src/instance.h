@@ -0,0 +1,152 @@
+/***********************************************************************************
+*   instance.h   :
+*
+* > geometry_group -         
+*                      ( );
+* > instance       -       
+*                    (transform.h).
+*
+* /    /
+*    :     ,  
+*    . bvh_node    
+* ( ),         (
+* : bvh_node   ,   - ). 
+*           
+*     .
+*
+*        ,  
+*    .   ,  t
+*       ,   
+*     t,     .
+*           
+* ;     
+* (transform::point_error()).
+*
+*    diffuse_light , ,   ,  
+*     (light.h -   ).
+***********************************************************************************/
+
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <string>
+#include <vector>
+
+#include "bvh.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "sphere.h"
+#include "transform.h"
+#include "triangle_mesh.h"
+
+/*
+ *   -   .   spheres 
+ * meshes  build();     ,   
+ *      (arena.h),    ,
+ *      shared_ptr.
+*/
+class geometry_group : public hittable
+{
+private:
+	scene_arena          nodes;	//   
+	shared_ptr<hittable> root;	// bvh_node      ( )
+	aabb bbox;
+
+public:
+	std::vector<sphere>        spheres;
+	std::vector<triangle_mesh> meshes;
+	std::vector<std::string>   mesh_paths;	//   meshes ( -   )
+
+	geometry_group() {}
+	geometry_group(const geometry_group&) = delete;
+	geometry_group& operator=(const geometry_group&) = delete;
+
+	/*    ;       */
+	void build(bvh_stats* stats = nullptr)
+	{
+		hittable_list list;
+		list.objects.reserve(spheres.size() + meshes.size());
+		for (sphere& s : spheres) { list.add(shared_ptr<hittable>(shared_ptr<hittable>(), &s)); }
+		for (triangle_mesh& m : meshes) { list.add(shared_ptr<hittable>(shared_ptr<hittable>(), &m)); }
+
+		root.reset();
+		nodes.release();
+		if (list.objects.empty()) { bbox = aabb(); }
+		else if (list.objects.size() == 1) { root = list.objects[0]; }
+		else { root = shared_ptr<hittable>(shared_ptr<hittable>(), nodes.create<bvh_node>(list, &nodes, stats)); }
+		if (root) { bbox = root->bounding_box(); }
+	}
+
+	size_t hierarchy_bytes() const { return nodes.bytes_used(); }
+
+	size_t triangle_count() const
+	{
+		size_t count = 0;
+		for (const triangle_mesh& m : meshes) { count += m.triangle_count(); }
+		return count;
+	}
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		return root && root->hit(r, ray_t, rec);
+	}
+
+	void hit_packet(const ray* rays, const int* active, int count, interval ray_t,
+		hit_record* recs, bool* hits) const override
+	{
+		if (root) { root->hit_packet(rays, active, count, ray_t, recs, hits); }
+	}
+
+	bool occluded(const ray& r, interval ray_t) const override
+	{
+		return root && root->occluded(r, ray_t);
+	}
+
+	aabb bounding_box() const override { return bbox; }
+};
+
+/*
+ *   geometry (, ,     - 
+ * bvh_node  )   to_world     
+ * .       .
+*/
+class instance : public hittable
+{
+private:
+	shared_ptr<hittable> geometry;
+	transform            to_world;
+	aabb                 bbox;	//     
+
+public:
+	instance(shared_ptr<hittable> geometry, const transform& to_world)
+		: geometry(std::move(geometry)), to_world(to_world)
+	{
+		bbox = to_world.apply(this->geometry->bounding_box());
+	}
+
+	const hittable*  get_geometry()  const { return geometry.get(); }
+	const transform& get_transform() const { return to_world; }
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		if (!geometry->hit(to_world.to_object(r), ray_t, rec)) { return false; }
+
+		/*
+		 *        ; (M^-1)^T
+		 *   dot(, ),  front_face  .
+		*/
+		rec.error  = to_world.point_error(rec.p, rec.error);
+		rec.p      = to_world.apply_point(rec.p);
+		rec.normal = unitv(to_world.apply_normal(rec.normal));
+		return true;
+	}
+
+	bool occluded(const ray& r, interval ray_t) const override
+	{
+		return geometry->occluded(to_world.to_object(r), ray_t);
+	}
+
+	aabb bounding_box() const override { return bbox; }
+};
+
+#endif
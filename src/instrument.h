@@ -0,0 +1,104 @@
+/***********************************************************************************
+*   instrument.h     :
+*    ,   BVH  ,  scatter() 
+*    ,   .
+*
+*    RT_INSTRUMENT ( CMake RT_INSTRUMENT).  
+*  RT_COUNT*()    ,    ,
+*       .
+*
+*       (thread_counters()), 
+*  .          
+*     (. camera::run_tiles()).
+***********************************************************************************/
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+struct instrument_counters
+{
+	static const int DEPTH_BINS     = 64;	//   -   DEPTH_BINS  
+	static const int MATERIAL_KINDS = 8;
+
+	long long primary_rays    = 0;
+	long long secondary_rays  = 0;
+	long long node_tests      = 0;	//    BVH
+	long long primitive_tests = 0;	//    
+	long long scatter_calls   = 0;
+	long long material_hits[MATERIAL_KINDS] = {};	//  -  material
+	long long path_length[DEPTH_BINS + 1]   = {};	//    n 
+
+	long long rays() const { return primary_rays + secondary_rays; }
+
+	void merge(const instrument_counters& other)
+	{
+		primary_rays    += other.primary_rays;
+		secondary_rays  += other.secondary_rays;
+		node_tests      += other.node_tests;
+		primitive_tests += other.primitive_tests;
+		scatter_calls   += other.scatter_calls;
+		for (int k = 0; k < MATERIAL_KINDS; ++k) { material_hits[k] += other.material_hits[k]; }
+		for (int k = 0; k <= DEPTH_BINS; ++k) { path_length[k] += other.path_length[k]; }
+	}
+
+	/* kind_name(k) -  k-   (nullptr -  ) */
+	void report(std::ostream& out, const char* (*kind_name)(size_t)) const
+	{
+		double per_ray = rays() > 0 ? 1.0 / rays() : 0;
+		out << "Rays: " << primary_rays << " primary, " << secondary_rays << " secondary; per ray "
+			<< node_tests * per_ray << " node tests, " << primitive_tests * per_ray << " primitive tests\n";
+
+		out << "Scatter: " << scatter_calls << " calls;";
+		for (int k = 0; k < MATERIAL_KINDS; ++k) {
+			if (const char* name = kind_name(size_t(k))) { out << ' ' << name << ' ' << material_hits[k]; }
+		}
+		out << '\n';
+
+		long long paths = 0;
+		for (long long n : path_length) { paths += n; }
+		//    ,  -  .
+		const int shown = 10;
+		long long longer = 0;
+		for (int k = shown + 1; k <= DEPTH_BINS; ++k) { longer += path_length[k]; }
+		out << "Path length:";
+		for (int k = 1; k <= shown; ++k) { out << ' ' << k << ": " << 100.0 * path_length[k] / std::max(paths, 1LL) << '%'; }
+		out << ' ' << shown + 1 << "+: " << 100.0 * longer / std::max(paths, 1LL) << "%\n";
+	}
+};
+
+#ifdef RT_INSTRUMENT
+
+inline instrument_counters& thread_counters()
+{
+	static thread_local instrument_counters counters;
+	return counters;
+}
+
+/*   cost      */
+class scope_timer
+{
+private:
+	float& cost;
+	std::chrono::steady_clock::time_point start;
+public:
+	explicit scope_timer(float& cost) : cost(cost), start(std::chrono::steady_clock::now()) {}
+	~scope_timer() { cost += float(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()); }
+};
+
+	#define RT_COUNT(field, n)        (thread_counters().field += (n))
+	#define RT_COUNT_MATERIAL(kind)   (++thread_counters().material_hits[std::min<size_t>((kind), instrument_counters::MATERIAL_KINDS - 1)])
+	#define RT_COUNT_PATH(length)     (++thread_counters().path_length[std::min<long long>((length), instrument_counters::DEPTH_BINS)])
+	#define RT_TIME_SCOPE(cost)       scope_timer rt_scope_timer_(cost)
+#else
+	#define RT_COUNT(field, n)        ((void)0)
+	#define RT_COUNT_MATERIAL(kind)   ((void)0)
+	#define RT_COUNT_PATH(length)     ((void)0)
+	#define RT_TIME_SCOPE(cost)       ((void)0)
+#endif
+
+#endif
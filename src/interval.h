@@ -1,22 +1,32 @@
 #ifndef INTERVAL_H
 #define INTERVAL_H
 
-class interval
+/*  [min, max]   T; interval -  basic_interval<real> */
+template <typename T>
+class basic_interval
 {
 public:
-	double min, max;
-	static const interval empty, universe;
+	T min, max;
+	static const basic_interval empty, universe;
 
-	interval() : min(+INF), max(-INF) {} //   !
-	interval(double min, double max) : min(min), max(max) {}
+	basic_interval() : min(T(+INF)), max(T(-INF)) {} //   !
+	basic_interval(T min, T max) : min(min), max(max) {}
+	basic_interval(const basic_interval& a, const basic_interval& b) // ,   
+		: min(a.min <= b.min ? a.min : b.min), max(a.max >= b.max ? a.max : b.max) {}
 
-	double size() const { return max - min; }
+	T size() const { return max - min; }
 	
-	bool contrains(double x) const { return min <= x && x <= max; } //  
+	bool contrains(T x) const { return min <= x && x <= max; } //  
 
-	bool surrounds(double x) const { return min < x && x < max; } //  
+	bool surrounds(T x) const { return min < x && x < max; } //  
 
-	double clip(double x) const
+	basic_interval expand(T delta) const
+	{
+		T padding = delta / 2;
+		return basic_interval(min - padding, max + padding);
+	}
+
+	T clip(T x) const
 	{
 		if (x < min) { return min; }
 		if (x > max) { return max;}
@@ -24,7 +34,9 @@ public:
 	}
 }; 
 
-const interval interval::empty		= interval(+INF, -INF);
-const interval interval::universe	= interval(-INF, +INF);
+template <typename T> const basic_interval<T> basic_interval<T>::empty	  = basic_interval<T>(T(+INF), T(-INF));
+template <typename T> const basic_interval<T> basic_interval<T>::universe = basic_interval<T>(T(-INF), T(+INF));
+
+using interval = basic_interval<real>;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,212 @@
+/***********************************************************************************
+*   light.h     light_list - 
+*   diffuse_light, -         
+* (next event estimation).
+*
+*       ,    
+*    ,         . 
+*     ( )     
+* ,    (hittable::occluded()) ,   .
+*
+* /     /
+*    ,    ( *
+* ),  -     ,    
+*   : cos(theta_max) = sqrt(1 - r^2/d^2),  
+* 1 / (2*PI*(1 - cos(theta_max))).       
+* ,        .
+*
+* /   (MIS) /
+*          :    
+* ,   .       
+* (Veach, 1997) w = p^2 / (p^2 + q^2),  p -  ,  ,  q -
+*       .    1, 
+*   ,        
+* ,    :        
+*  ,  -      .
+***********************************************************************************/
+
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "hittable_list.h"
+#include "material.h"
+#include "sphere.h"
+
+/*
+ *      (0, 1 - SHADOW_EPSILON)    
+ * :       ,   
+ *         .
+*/
+const real SHADOW_EPSILON = real(1e-4);
+
+/*        f ()  g () */
+inline double power_heuristic(double f, double g)
+{
+	double f2 = f * f, g2 = g * g;
+	return (f2 + g2) > 0 ? f2 / (f2 + g2) : 0;
+}
+
+/*   ,  light_list::sample() */
+struct light_sample
+{
+	point3 p;			//    
+	vec3   normal;		//    p
+	color  emit;		//  
+	double pdf   = 0;	//    p    (   )
+	real   error = 0;	//    p
+
+	/*
+	 *     rec  p:       
+	 *  (. hit_record::spawn_ray()), t = 1 -   .
+	*/
+	ray shadow_ray(const hit_record& rec) const
+	{
+		ray  from = rec.spawn_ray(p - rec.p);
+		real d = error * (std::fabs(normal.x()) + std::fabs(normal.y()) + std::fabs(normal.z()));
+		return ray(from.origin(), (p + d * normal) - from.origin());
+	}
+};
+
+class light_list
+{
+private:
+	struct sphere_light
+	{
+		point3   center;
+		real     radius;
+		uint32_t mat;	//  diffuse_light   
+		color    emit;
+	};
+
+	std::vector<sphere_light> lights;
+	std::vector<double>       cumulative_power;	//    [0, k]
+	std::vector<std::pair<uint32_t, uint32_t>> by_material; // (, ),  
+	double total_power = 0;
+
+	static double luminance(const color& c) { return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z(); }
+
+	/*    k */
+	double select_pdf(size_t k) const
+	{
+		return (cumulative_power[k] - (k > 0 ? cumulative_power[k-1] : 0.0)) / total_power;
+	}
+
+	/* 1 - cos(theta_max) ,    k   ref (0 - ref ) */
+	double cone_solid_angle_factor(size_t k, const point3& ref) const
+	{
+		double d2 = (lights[k].center - ref).length_squared();
+		double r2 = double(lights[k].radius) * lights[k].radius;
+		if (d2 <= r2) { return 0; }
+		double sin2 = r2 / d2;
+		return sin2 / (1 + std::sqrt(1 - sin2)); //       
+	}
+
+	/*
+	 * ,       rec (-1 -  :
+	 *           sample()).
+	*/
+	long find(const hit_record& rec) const
+	{
+		auto range = std::equal_range(by_material.begin(), by_material.end(), std::make_pair(rec.mat_id, 0u),
+			[](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) { return a.first < b.first; });
+		long   best = -1;
+		double best_distance = INF;
+		for (auto it = range.first; it != range.second; ++it) {
+			const sphere_light& l = lights[it->second];
+			double distance = std::fabs((rec.p - l.center).length() - l.radius);
+			if (distance < best_distance && distance <= 1e-3 * l.radius + rec.error) { best_distance = distance; best = long(it->second); }
+		}
+		return best;
+	}
+
+public:
+	light_list() {}
+
+	/*   world,   - diffuse_light */
+	light_list(const hittable_list& world, const material_table& materials)
+	{
+		for (const shared_ptr<hittable>& object : world.objects) {
+			const sphere* s = dynamic_cast<const sphere*>(object.get());
+			if (!s) { continue; }
+			if (const diffuse_light* l = std::get_if<diffuse_light>(&materials[s->get_material()])) {
+				add(s->get_center(), s->get_radius(), s->get_material(), l->get_emit());
+			}
+		}
+	}
+
+	void add(const point3& center, real radius, uint32_t mat, const color& emit)
+	{
+		double power = luminance(emit) * 4 * PI * double(radius) * radius * PI;
+		if (!(power > 0)) { return; }
+
+		lights.push_back({ center, radius, mat, emit });
+		total_power += power;
+		cumulative_power.push_back(total_power);
+
+		std::pair<uint32_t, uint32_t> key(mat, uint32_t(lights.size() - 1));
+		by_material.insert(std::upper_bound(by_material.begin(), by_material.end(), key), key);
+	}
+
+	bool   empty() const { return lights.empty(); }
+	size_t size()  const { return lights.size(); }
+	double power() const { return total_power; }
+
+	/*
+	 *     u_light      u,   ref. 
+	 * ref    false.
+	*/
+	bool sample(const point3& ref, double u_light, const sample2& u, light_sample& ls) const
+	{
+		if (lights.empty()) { return false; }
+		size_t k = size_t(std::upper_bound(cumulative_power.begin(), cumulative_power.end(), u_light * total_power) 
+			- cumulative_power.begin());
+		k = std::min(k, lights.size() - 1);
+		const sphere_light& l = lights[k];
+
+		double cone = cone_solid_angle_factor(k, ref);
+		if (cone <= 0) { return false; }
+
+		/*   : 1 - cos(theta)   [0, cone] */
+		vec3   to_center = l.center - ref;
+		double d = to_center.length();
+		double one_minus_cos = u.u * cone;
+		double cos_theta = 1 - one_minus_cos;
+		double sin_theta = std::sqrt(std::fmax(0.0, one_minus_cos * (2 - one_minus_cos)));
+		double sin_phi, cos_phi;
+		sincos_turn(u.v, sin_phi, cos_phi);
+		vec3 dir = onb(to_center / real(d)).to_world(vec3(real(sin_theta * cos_phi), real(sin_theta * sin_phi), real(cos_theta)));
+
+		/*     ,     */
+		double r  = l.radius;
+		double t  = d * cos_theta - std::sqrt(std::fmax(0.0, r * r - d * d * sin_theta * sin_theta));
+		vec3 radial = (ref + real(t) * dir) - l.center;
+		radial *= real(r / radial.length());
+
+		ls.p      = l.center + radial;
+		ls.normal = radial / real(r);
+		ls.emit   = l.emit;
+		ls.pdf    = select_pdf(k) / (2 * PI * cone);
+		real extent = std::fmax(std::fabs(l.center.x()), std::fmax(std::fabs(l.center.y()), std::fabs(l.center.z()))) + l.radius;
+		ls.error  = rounding_bound(8) * extent;
+		return true;
+	}
+
+	/*
+	 * ,   sample()   ref     
+	 *  rec (  MIS      ).
+	*/
+	double pdf(const point3& ref, const hit_record& rec) const
+	{
+		long k = find(rec);
+		if (k < 0) { return 0; }
+		double cone = cone_solid_angle_factor(size_t(k), ref);
+		return cone > 0 ? select_pdf(size_t(k)) / (2 * PI * cone) : 0;
+	}
+};
+
+#endif
@@ -1,6 +1,7 @@
 ﻿/***********************************************************************************
 * Данная программа рассчитывает значения матрицы пискслей и записывает их в формате 
-* P3, т.е. цвета даны в ASCII - 24 бита на пиксель (по 8 бит на r,g,b). 
+* P6, т.е. цвета даны в двоичном виде - 24 бита на пиксель (по 8 бит на r,g,b). 
+* Также поддерживаются форматы PFM (float, без гамма-коррекции) и PNG.
 * 
 * Выходной файл ((>) file.ppm) содержит значения для пикселя в количестве 256 x 256, 
 * значения которых не превышают 255.
@@ -19,6 +20,46 @@
 *
 * cmake ..
 * cmake --build . --config Release
+*
+* ray-tracing [--scene file] [-o file.ppm|file.pfm|file.png] [--format ppm|pfm|png] [--stream]
+*             [--adaptive] [--spp-heatmap file] [--pass-spp N [--preview file] [--checkpoint file
+*             [--resume]]] [--cost-heatmap file] [--sampler independent|stratified|sobol [--strata N]]
+*             [--no-light-sampling] [--ao DISTANCE] [--bvh node|flat|wide] [--bvh-build sah|morton]
+*             [--bench]
+* ray-tracing --convert scene.txt scene.rtsb
+* ray-tracing --diff a.pfm b.pfm [--tolerance RMSE]
+* > --scene   файл сцены, текстовый или двоичный (по умолчанию scenes/cover.txt, см. scene.h);
+* > --convert преобразовать текстовое описание сцены в двоичное и завершить работу;
+* > --diff    сравнить два изображения PFM (например, сборок double и float, см.
+*             image_diff.h); код возврата 1, если RMSE больше --tolerance (0.01);
+* > -o        файл изображения, формат определяется по расширению (по умолчанию
+*             изображение выводится в стандартный поток: ray-tracing > file.ppm);
+* > --format  формат изображения для стандартного потока;
+* > --stream  потоковый режим трассировки (пакеты первичных лучей, см. camera.h);
+*             с --adaptive, --pass-spp и --ao не допускается (там только скалярная);
+* > --adaptive адаптивное число сэмплов на пиксель (не более SAMPLES_PER_PIXEL);
+* > --spp-heatmap файл тепловой карты числа сэмплов в адаптивном режиме;
+* > --cost-heatmap файл карты времени визуализации пикселей и счетчики трассировки
+*             (только в сборке с RT_INSTRUMENT: cmake -DRT_INSTRUMENT=ON);
+* > --pass-spp прогрессивная визуализация проходами по N сэмплов на пиксель;
+*             с --adaptive не допускается (проходы всегда по N сэмплов);
+* > --preview промежуточное изображение после каждого прохода;
+* > --checkpoint файл контрольной точки, --resume - продолжить с нее;
+* > --sampler способ получения чисел сэмплов (по умолчанию independent, см. sampler.h);
+* > --strata  число клеток сетки сэмплера stratified (по умолчанию - число сэмплов);
+* > --no-light-sampling не оценивать прямое освещение источников diffuse_light
+*             теневыми лучами: свет находят только отраженные лучи (см. light.h);
+* > --ao      вместо освещенности - затенение окружением с радиусом DISTANCE (см.
+*             camera::ambient_occlusion());
+* > --bvh     иерархия объемов сцены: bvh_node (bvh.h), двоичная плоская flat_bvh
+*             (flat_bvh.h) или четырехарная wide_bvh (wide_bvh.h, по умолчанию);
+* > --bvh-build построение flat_bvh и wide_bvh на всех потоках: по SAH (по умолчанию)
+*             или по кодам Мортона - быстрее, но дерево хуже (для предпросмотра);
+*             с --bvh node не допускается (bvh_node строится только по SAH);
+* > --bench   сравнение пропускной способности hittable_list, sphere_soa (для
+*             каждого доступного набора инструкций) и иерархий, запросов видимости
+*             hit() и occluded(), время операций vec3 и генерации случайных
+*             направлений (sampling.h).
 ***********************************************************************************/
 
 #include "rt_settings.h"
@@ -27,71 +68,270 @@
 #include "sphere.h"
 #include "camera.h"
 #include "material.h"
-#include "time.h"
+#include "bvh.h"
+#include "flat_bvh.h"
+#include "wide_bvh.h"
+#include "sphere_soa.h"
+#include "benchmark.h"
+#include "scene.h"
+#include "image_diff.h"
+
+#include <chrono>
+#include <cstring>
 
-int main() 
+int main(int argc, char* argv[]) 
 {
 	// settings
 	std::ios_base::sync_with_stdio(0);
 
+	bool         bench = false;
+	std::string  output_path;
+	image_format output_format = image_format::ppm;
+	render_mode  render        = render_mode::scalar;
+	bool         adaptive      = false;
+	std::string  heatmap_path, cost_path;
+	int          pass_spp = 0;
+	std::string  preview_path, checkpoint_path;
+	bool         resume = false;
+	std::string  scene_path = "scenes/cover.txt";
+	sampler_type sampling = sampler_type::independent;
+	int          strata = 0;
+	bool         light_sampling = true;
+	double       ao_distance = 0;	// 0 - освещенность путями
+	std::string  convert_path;
+	std::string  diff_paths[2];
+	double       tolerance = 0.01;
+	std::string  hierarchy = "wide";
+	bvh_build    build_mode = bvh_build::sah;
+	bool         build_given = false;
+	for (int k = 1; k < argc; ++k) {
+		if (std::strcmp(argv[k], "--bench") == 0) { bench = true; }
+		else if (std::strcmp(argv[k], "-o") == 0 && k + 1 < argc) { output_path = argv[++k]; }
+		else if (std::strcmp(argv[k], "--format") == 0 && k + 1 < argc) { 
+			output_format = image_format_from_path(std::string(".") + argv[++k]); 
+		}
+		else if (std::strcmp(argv[k], "--stream") == 0) { render = render_mode::stream; }
+		else if (std::strcmp(argv[k], "--adaptive") == 0) { adaptive = true; }
+		else if (std::strcmp(argv[k], "--spp-heatmap") == 0 && k + 1 < argc) { heatmap_path = argv[++k]; }
+		else if (std::strcmp(argv[k], "--cost-heatmap") == 0 && k + 1 < argc) { cost_path = argv[++k]; }
+		else if (std::strcmp(argv[k], "--pass-spp") == 0 && k + 1 < argc) { pass_spp = std::atoi(argv[++k]); }
+		else if (std::strcmp(argv[k], "--preview") == 0 && k + 1 < argc) { preview_path = argv[++k]; }
+		else if (std::strcmp(argv[k], "--checkpoint") == 0 && k + 1 < argc) { checkpoint_path = argv[++k]; }
+		else if (std::strcmp(argv[k], "--resume") == 0) { resume = true; }
+		else if (std::strcmp(argv[k], "--scene") == 0 && k + 1 < argc) { scene_path = argv[++k]; }
+		else if (std::strcmp(argv[k], "--sampler") == 0 && k + 1 < argc) {
+			if (!sampler_type_from_name(argv[++k], sampling)) { std::cerr << "Unknown sampler: " << argv[k] << '\n'; return 1; }
+		}
+		else if (std::strcmp(argv[k], "--strata") == 0 && k + 1 < argc) { strata = std::atoi(argv[++k]); }
+		else if (std::strcmp(argv[k], "--no-light-sampling") == 0) { light_sampling = false; }
+		else if (std::strcmp(argv[k], "--ao") == 0 && k + 1 < argc) { ao_distance = std::atof(argv[++k]); }
+		else if (std::strcmp(argv[k], "--convert") == 0 && k + 2 < argc) { scene_path = argv[++k]; convert_path = argv[++k]; }
+		else if (std::strcmp(argv[k], "--diff") == 0 && k + 2 < argc) { diff_paths[0] = argv[++k]; diff_paths[1] = argv[++k]; }
+		else if (std::strcmp(argv[k], "--tolerance") == 0 && k + 1 < argc) { tolerance = std::atof(argv[++k]); }
+		else if (std::strcmp(argv[k], "--bvh") == 0 && k + 1 < argc) {
+			hierarchy = argv[++k];
+			if (hierarchy != "node" && hierarchy != "flat" && hierarchy != "wide") { std::cerr << "Unknown hierarchy: " << hierarchy << '\n'; return 1; }
+		}
+		else if (std::strcmp(argv[k], "--bvh-build") == 0 && k + 1 < argc) {
+			if (!bvh_build_from_name(argv[++k], build_mode)) { std::cerr << "Unknown BVH build: " << argv[k] << '\n'; return 1; }
+			build_given = true;
+		}
+		else { std::cerr << "Unknown argument: " << argv[k] << '\n'; return 1; }
+	}
+	if (build_given && hierarchy == "node") {
+		std::cerr << "--bvh-build applies to --bvh flat|wide; bvh_node is always built by SAH with full sorting\n";
+		return 1;
+	}
+	if (adaptive && pass_spp > 0) {
+		std::cerr << "--adaptive cannot be combined with --pass-spp; progressive passes always take N samples per pixel\n";
+		return 1;
+	}
+	if (render == render_mode::stream && (adaptive || pass_spp > 0 || ao_distance > 0)) {
+		std::cerr << "--stream cannot be combined with --adaptive, --pass-spp or --ao; they trace rays one at a time\n";
+		return 1;
+	}
 	
-	hittable_list WORLD;
-	shared_ptr<material> ground_mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
-	WORLD.add(make_shared<sphere>(point3(0, -1000, 0), 1000, ground_mat));
-	for (int a = -11; a < 11; ++a) {
-		for (int b = -11; b < 11; ++b) {
-			double choose_mat = random_double();
-			point3 center(a + 0.9*random_double(), 0.2, b + 0.9*random_double());
-			if ((center - point3(4, 0.2, 0)).length() > 0.9) { 
-				shared_ptr<material> sphere_mat; 
-
-				if (choose_mat < 0.8) {
-					/* diffuse */
-					color albedo = color::random() * color::random();
-					sphere_mat = make_shared<lambertian>(albedo);
-				}
-				else if (choose_mat < 0.95) {
-					/* metal */
-					color albedo = color::random(0.5, 1);
-					double fuzz = random_double(0, 0.5);
-					sphere_mat = make_shared<metal>(albedo, fuzz);
-				}
-				else {
-					/* glass */
-					sphere_mat = make_shared<dielectric>(1.5);
-				}
-				WORLD.add(make_shared<sphere>(center, 0.2, sphere_mat));
-			}
+	/* --diff: сравнение двух изображений */
+	if (!diff_paths[0].empty()) {
+		framebuffer a, b;
+		std::string error;
+		if (!read_pfm(diff_paths[0], a, error) || !read_pfm(diff_paths[1], b, error)) { std::cerr << error << '\n'; return 1; }
+		if (a.get_width() != b.get_width() || a.get_height() != b.get_height()) {
+			std::cerr << "Image sizes differ: " << a.get_width() << 'x' << a.get_height() << " and " 
+					  << b.get_width() << 'x' << b.get_height() << '\n';
+			return 1;
 		}
+		image_difference diff = compare_images(a, b);
+		diff.report(std::clog);
+		bool passed = diff.rmse <= tolerance;
+		std::clog << (passed ? "PASS" : "FAIL") << " (tolerance " << tolerance << ")\n";
+		return passed ? 0 : 1;
 	}
-	shared_ptr<material> mat1 = make_shared<dielectric>(1.5);
-	WORLD.add(make_shared<sphere>(point3(0, 1, 0), 1.0, mat1));
 
-	shared_ptr<material> mat2 = make_shared<lambertian>(color(0.4, 0.2, 0.1));
-	WORLD.add(make_shared<sphere>(point3(-4, 1, 0), 1.0, mat2));
+	/* --convert: текстовое описание сцены в двоичное */
+	if (!convert_path.empty()) {
+		scene source;
+		if (!source.load(scene_path) || !source.save_binary(convert_path)) { std::cerr << source.error << '\n'; return 1; }
+		std::clog << scene_path << " -> " << convert_path << ": " << source.spheres.size() << " spheres, "
+				  << source.meshes.size() << " meshes, " << source.instances.size() << " instances, "
+				  << source.materials.size() << " materials\n";
+		return 0;
+	}
 
-	shared_ptr<material> mat3 = make_shared<metal>(color(0.7, 0.6, 0.5), 0.0);
-	WORLD.add(make_shared<sphere>(point3(4, 1, 0), 1.0, mat3));
-	
-	camera cam;
-	cam.ASPECT_RATIO = 16.0 / 9.0;
-	cam.IMAGE_WIDTH  = 1920;
-	cam.SAMPLES_PER_PIXEL = 500;
-	cam.MAX_DEPTH = 50;
-
-	cam.VFOV = 20;
-	cam.LOOKFROM = point3(13,2,3);
-	cam.LOOKAT = point3(0,0,0);
-	cam.VUP = vec3(0,1,0);
-	cam.FOCUS_ANGLE = 0.6;
-	cam.FOCUS_DIST = 10.0;
-
-	clock_t start, stop;
+	scene SCENE_FILE;
+	if (!SCENE_FILE.load(scene_path)) { std::cerr << SCENE_FILE.error << '\n'; return 1; }
+	std::clog << "Scene: " << SCENE_FILE.spheres.size() << " spheres, " << SCENE_FILE.materials.size()
+			  << " materials, loaded in " << SCENE_FILE.load_ms << " ms\n";
+	std::vector<const triangle_mesh*> all_meshes; // сетки сцены и объектов экземпляров
+	for (const triangle_mesh& m : SCENE_FILE.meshes) { all_meshes.push_back(&m); }
+	for (const auto& object : SCENE_FILE.objects) {
+		for (const triangle_mesh& m : object->meshes) { all_meshes.push_back(&m); }
+	}
+	if (!all_meshes.empty()) {
+		size_t mesh_bytes = 0;
+		double mesh_build_ms = 0;
+		for (const triangle_mesh* m : all_meshes) {
+			mesh_bytes += m->memory_bytes();
+			mesh_build_ms += m->hierarchy_stats().build_ms;
+		}
+		std::clog << "Meshes: " << all_meshes.size() << ", " << SCENE_FILE.triangle_count() << " triangles, "
+				  << mesh_bytes / (1024.0 * 1024.0) << " MiB, hierarchies built in " << mesh_build_ms << " ms\n";
+	}
+	if (!SCENE_FILE.instances.empty()) {
+		std::clog << "Instances: " << SCENE_FILE.instances.size() << " of " << SCENE_FILE.objects.size() << " objects, "
+				  << SCENE_FILE.instanced_triangle_count() << " triangles instanced, "
+				  << SCENE_FILE.instances.size() * sizeof(instance) / (1024.0 * 1024.0) << " MiB of instance records\n";
+	}
+
+	const material_table& MATERIALS = SCENE_FILE.materials;
+	hittable_list WORLD = SCENE_FILE.world();
+	light_list    LIGHTS(WORLD, MATERIALS);
+	if (!LIGHTS.empty()) { std::clog << "Lights: " << LIGHTS.size() << '\n'; }
+
+	/* иерархия объемов вместо линейного перебора; узлы bvh_node - подряд в области ARENA */
+	scene_arena          ARENA;
+	bvh_stats            bvh_info;
+	shared_ptr<hittable> ROOT;
+	if (hierarchy == "node") { ROOT = shared_ptr<hittable>(shared_ptr<hittable>(), ARENA.create<bvh_node>(WORLD, &ARENA, &bvh_info)); }
+	else if (hierarchy == "flat") { ROOT = make_shared<flat_bvh>(WORLD, &bvh_info, build_mode); }
+	else { ROOT = make_shared<wide_bvh>(WORLD, &bvh_info, build_mode); }
+	hittable_list SCENE(ROOT);
+	std::clog << "Hierarchy: " << (hierarchy == "node" ? "bvh_node, full-sort SAH build"
+								   : hierarchy + "_bvh, " + bvh_build_name(build_mode) + " build") << '\n';
+	bvh_info.report(std::clog);
+	if (ARENA.block_count() > 0) {
+		std::clog << "Arena: " << ARENA.bytes_used() / 1024.0 << " KiB used of " << ARENA.bytes_reserved() / 1024.0
+				  << " KiB in " << ARENA.block_count() << " blocks\n";
+	}
+
+	camera cam = SCENE_FILE.cam;
+	cam.OUTPUT_PATH   = output_path;
+	cam.OUTPUT_FORMAT = output_format;
+	cam.RENDER_MODE   = render;
+	cam.ADAPTIVE      = adaptive;
+	cam.SPP_HEATMAP_PATH = heatmap_path;
+	cam.COST_HEATMAP_PATH = cost_path;
+	cam.PASS_SPP        = pass_spp;
+	cam.PREVIEW_PATH    = preview_path;
+	cam.CHECKPOINT_PATH = checkpoint_path;
+	cam.RESUME          = resume;
+	cam.SAMPLER         = sampling;
+	cam.STRATA          = strata;
+	cam.LIGHT_SAMPLING  = light_sampling;
+	if (ao_distance > 0) {
+		cam.SHADING     = shading_mode::ambient_occlusion;
+		cam.AO_DISTANCE = ao_distance;
+	}
+
+	/* --bench: сравнение пропускной способности структур сцены на одних лучах */
+	if (bench) {
+		sphere_soa SPHERES;
+		for (const sphere& object : SCENE_FILE.spheres) { SPHERES.add(object); }
+
+		std::vector<ray> rays = make_benchmark_rays(cam.LOOKFROM, WORLD.bounding_box(), 200000, 1);
+		bench_result flat = bench_hit(WORLD, rays);
+		std::clog << "hittable_list:     " << flat.rays_per_second() / 1e6 << " Mrays/s (" << flat.hits << " hits)\n";
+
+		for (int l = 0; l <= int(detect_simd_level()); ++l) {
+			SPHERES.set_simd_level(simd_level(l));
+			bench_result soa = bench_hit(SPHERES, rays);
+			std::clog << "sphere_soa/" << simd_level_name(simd_level(l)) << ": " << soa.rays_per_second() / 1e6 
+					  << " Mrays/s (" << soa.hits << " hits), " << soa.rays_per_second() / flat.rays_per_second() << "x\n";
+		}
+
+		/* иерархии: узлы в куче, плоская двоичная и четырехарная (для каждого набора инструкций) */
+		bvh_node TREE(WORLD);
+		flat_bvh FLAT(WORLD);
+		wide_bvh WIDE(WORLD);
+		auto report_tree = [&](const std::string& name, const hittable& root) {
+			bench_result tree = bench_hit(root, rays);
+			std::clog << name << ": " << tree.rays_per_second() / 1e6 << " Mrays/s (" << tree.hits << " hits), "
+					  << tree.rays_per_second() / flat.rays_per_second() << "x\n";
+		};
+		report_tree("bvh_node", TREE);
+		report_tree("flat_bvh", FLAT);
+		for (simd_level l : { simd_level::scalar, simd_level::avx2 }) { // с AVX-512 используется ядро AVX2
+			if (l > detect_simd_level()) { break; }
+			WIDE.set_simd_level(l);
+			report_tree(std::string("wide_bvh/") + simd_level_name(l), WIDE);
+		}
+		WIDE.set_simd_level(detect_simd_level());
+
+		/* запросы видимости (отрезки затенения окружением длиной 1): hit() против occluded() */
+		std::vector<ray> shadow_rays = make_occlusion_rays(SCENE, rays, 1.0, 2);
+		auto report_visibility = [](const char* name, const visibility_result& v) {
+			std::clog << "occlusion/" << name << v.hit.rays_per_second() / 1e6 << " Mrays/s hit(), " 
+					  << v.occluded.rays_per_second() / 1e6 << " Mrays/s occluded(), " << v.speedup() << "x ("
+					  << v.occluded.hits << (v.hit.hits == v.occluded.hits ? " blocked)\n" : " blocked, MISMATCH)\n");
+		};
+		report_visibility("hittable_list: ", bench_visibility(WORLD, shadow_rays));
+		SPHERES.set_simd_level(detect_simd_level());
+		report_visibility("sphere_soa:    ", bench_visibility(SPHERES, shadow_rays, 5));
+		report_visibility("bvh_node:      ", bench_visibility(TREE, shadow_rays, 5));
+		report_visibility("flat_bvh:      ", bench_visibility(FLAT, shadow_rays, 5));
+		report_visibility("wide_bvh:      ", bench_visibility(WIDE, shadow_rays, 5));
+
+		/* стоимость одного попадания: shared_ptr + виртуальный вызов против индекса + variant */
+		dispatch_result dispatch = bench_material_dispatch(MATERIALS, 2000000, cam.THREADS);
+		std::clog << "material dispatch (" << dispatch.threads << " threads): shared_ptr + virtual " << dispatch.virtual_ns
+				  << " ns/hit, index + variant " << dispatch.variant_ns << " ns/hit\n";
+
+		vec3_ops_result ops = bench_vec3_ops();
+		std::clog << "vec3 (" << (vec3_lanes<real>::enabled ? "simd" : "scalar") << "): add " << ops.add_ns << " ns, dot " 
+				  << ops.dot_ns << " ns, cross " << ops.cross_ns << " ns, length " << ops.length_ns << " ns, unitv " 
+				  << ops.unitv_ns << " ns\n";
+
+		sampling_result sampling = bench_sampling();
+		std::clog << "sampling (ns/sample): unit vector rejection " << sampling.rejection_sphere_ns << ", warp " 
+				  << sampling.warp_sphere_ns << "; unit disk rejection " << sampling.rejection_disk_ns << ", warp " 
+				  << sampling.warp_disk_ns << "; batch sphere " << sampling.batch_sphere_ns << ", cosine hemisphere " 
+				  << sampling.batch_cosine_ns << ", concentric disk " << sampling.batch_disk_ns << '\n';
+
+		/* первичные лучи (одно отражение) и полные пути для скалярного и потокового режимов */
+		camera bench_cam = cam;
+		bench_cam.IMAGE_WIDTH = 480;
+		bench_cam.SAMPLES_PER_PIXEL = 4;
+		const char* mode_names[] = { "scalar", "stream" };
+		for (render_mode mode : { render_mode::scalar, render_mode::stream }) {
+			bench_cam.RENDER_MODE = mode;
+			bench_cam.MAX_DEPTH = 1;
+			bench_result primary = bench_render(bench_cam, SCENE, MATERIALS);
+			bench_cam.MAX_DEPTH = cam.MAX_DEPTH;
+			bench_result full = bench_render(bench_cam, SCENE, MATERIALS);
+			std::clog << "render/" << mode_names[int(mode)] << ": primary " << primary.rays_per_second() / 1e6 
+					  << " Msamples/s, full path " << full.rays_per_second() / 1e6 << " Msamples/s\n";
+		}
+		bench_cam.RENDER_MODE = render_mode::scalar;
+		bench_cam.SHADING     = shading_mode::ambient_occlusion;
+		bench_result ao = bench_render(bench_cam, SCENE, MATERIALS);
+		std::clog << "render/ambient occlusion: " << ao.rays_per_second() / 1e6 << " Msamples/s\n";
+		return 0;
+	}
 	
-	start = clock();
-	cam.render(WORLD);
-	stop = clock();
+	auto start = std::chrono::steady_clock::now();
+	cam.render(SCENE, MATERIALS, &LIGHTS);
+	auto stop = std::chrono::steady_clock::now();
 
-	double timer = ((double)(stop - start)) / CLOCKS_PER_SEC;
-	std::cerr << "took " << timer << " seconds.\n";
+	double timer = std::chrono::duration<double>(stop - start).count();
+	std::cerr << "render took " << timer << " seconds.\n";
 }
\ No newline at end of file
@@ -1,44 +1,100 @@
+/***********************************************************************************
+*     lambertian, metal  dielectric  
+*     .  material -  std::variant  :
+*        ,  
+*  .       material_table, 
+* hit_record   32-    .
+*
+*  scatter(material, ...)      (std::visit,
+* .. switch   ),      
+* ,   shared_ptr     , 
+*    .
+*
+* /   /
+*      (BSDF) f(wo, wi),  wo -
+*   , wi -     (  ):
+*
+* > sample(r_in, rec, gen, bs) -   wi   pdf(wi) 
+*       f  pdf (bsdf_sample);
+* > eval(rec, wo, wi)          -  f    ;
+* > pdf(rec, wo, wi)           - ,   sample()   wi.
+*
+*     -  f * |cos(wi, n)| / pdf (.
+* bsdf_sample::weight()).  ()  - , ,  
+*   metal,      , - 
+* specular:  f    cos/pdf,  eval()  pdf()    ,
+* ..      -   .
+*
+* /   /
+* diffuse_light        (emitted())
+*    .        
+* light_list (light.h),        .
+***********************************************************************************/
+
 #ifndef MATERIAL_H
 #define MATERIAL_H
 
+#include <variant>
+#include <vector>
+
 #include "hittable.h"
+#include "sampler.h"
 
-class material
+/*  sample():  ,  BSDF   */
+struct bsdf_sample
 {
-public:
-	virtual ~material() = default;
-	
-	virtual bool scatter(const ray& r_in, const hit_record& rec,
-		color& attenuation, ray& scattered) const
+	vec3   direction;			// wi,   
+	color  f;					// f(wo, wi);  specular -  f*cos/pdf
+	double pdf      = 0;		//  wi   
+	bool   specular = false;	// - (eval()  pdf()  0)
+
+	/*  throughput : f * |cos(wi, n)| / pdf */
+	color weight(const vec3& normal) const
 	{
-		return false;
+		if (specular) { return f; }
+		double cos_theta = std::fabs(dot(unitv(direction), normal));
+		return f * real(cos_theta / pdf);
 	}
 };
 
-class lambertian : public material
+class lambertian
 {
 private:
 	color albedo;
 public:
 	lambertian(const color& albedo) : albedo(albedo) {}
 
-	bool scatter(const ray& r_in, const hit_record& rec,
-		 color& attenuation, ray& scattered) const override
+	const color& get_albedo() const { return albedo; }
+
+	/*
+	 *     cos(theta)/PI -  
+	 * cos(theta)  ,   f*cos/pdf = albedo  (importance
+	 * sampling).   normal + random_unit_vector()   
+	 * ,       .
+	*/
+	bool sample(const ray& r_in, const hit_record& rec, sampler& gen, bsdf_sample& bs) const
 	{
-		vec3 scatter_dir = (rec.normal + random_unit_vector()); //  ,  
-															    // .
+		bs.direction = onb(rec.normal).to_world(sample_cosine_hemisphere(gen.get_2d()));
+		bs.pdf       = pdf(rec, -r_in.direction(), bs.direction);
+		bs.f         = eval(rec, -r_in.direction(), bs.direction);
+		bs.specular  = false;
+		return bs.pdf > 0;
+	}
 
-		/*         */
-		if (scatter_dir.near_zero()) { scatter_dir = rec.normal; }
+	/*  : f = albedo / PI    */
+	color eval(const hit_record& rec, const vec3& wo, const vec3& wi) const
+	{
+		if (dot(wi, rec.normal) <= 0 || dot(wo, rec.normal) <= 0) { return color(0,0,0); }
+		return albedo * real(1 / PI);
+	}
 
-		scattered = ray(rec.p, scatter_dir);				    //   
-		attenuation = albedo;								    //      (
-															    //  ).
-		return true;
+	double pdf(const hit_record& rec, const vec3&, const vec3& wi) const
+	{
+		return cosine_hemisphere_pdf(dot(unitv(wi), rec.normal));
 	}
 };
 
-class metal : public material
+class metal
 {
 private:
 	color albedo;
@@ -46,13 +102,15 @@ private:
 public:
 	metal(const color& albedo, double fuzz) : albedo(albedo), fuzz(fuzz < 1 ? fuzz:1) {}
 
-	bool scatter(const ray& r_in, const hit_record& rec,
-		 color& attenuation, ray& scattered) const override
+	const color& get_albedo() const { return albedo; }
+	double       get_fuzz()   const { return fuzz; }
+
+	bool sample(const ray& r_in, const hit_record& rec, sampler& gen, bsdf_sample& bs) const
 	{
 		vec3 reflected = reflect(r_in.direction(), rec.normal);			//         
 																		// .
 		
-		reflected = unitv(reflected) + (fuzz * random_unit_vector());	//  ,    ,
+		reflected = unitv(reflected) + (fuzz * sample_uniform_sphere(gen.get_2d()));	//  ,    ,
 																		//  . fuzz,    
 																		//    (..   
 																		//  .
@@ -63,13 +121,18 @@ public:
 																		//  .
 
 
-		scattered = ray(rec.p, reflected);								//   .
-		attenuation = albedo;											//      (
+		bs.direction = reflected;										//   .
+		bs.f         = albedo;											//      (
 																		//  ).
+		bs.pdf       = 1;
+		bs.specular  = true;
 		
-		return (dot(scattered.direction(), rec.normal) > 0);			//        
+		return (dot(reflected, rec.normal) > 0);						//        
 																		//  .
 	}
+
+	color  eval(const hit_record&, const vec3&, const vec3&) const { return color(0,0,0); }
+	double pdf(const hit_record&, const vec3&, const vec3&) const { return 0; }
 };
 
 /*
@@ -82,7 +145,7 @@ public:
  *   ,      ,
  *    .
 */
-class dielectric : public material
+class dielectric
 {
 private: 
 	double refraction_index; //       
@@ -101,10 +164,13 @@ private:
 public:
 	dielectric(double refraction_index) : refraction_index(refraction_index) {}
 
-	bool scatter(const ray& r_in, const hit_record& rec,
-		color& attenuation, ray& scattered) const override
+	double get_refraction_index() const { return refraction_index; }
+
+	bool sample(const ray& r_in, const hit_record& rec, sampler& gen, bsdf_sample& bs) const
 	{
-		attenuation = color(1.0, 1.0, 1.0); //   1, ..     .
+		bs.f        = color(1.0, 1.0, 1.0); //   1, ..     .
+		bs.pdf      = 1;
+		bs.specular = true;
 
 		double ri = rec.front_face ? (1.0/refraction_index) : refraction_index; //    .
 
@@ -127,13 +193,111 @@ public:
 
 		//   sin(theta_prime)   ,   
 		//    (   ) .
-		if (cannot_refract || reflectance(cos_theta, ri) > random_double()) 
+		if (cannot_refract || reflectance(cos_theta, ri) > gen.get_1d()) 
 			direction = reflect(unit_direction, rec.normal);
 		else { direction = refract(unit_direction, rec.normal, ri); }
 
-		scattered = ray(rec.p, direction);										//     .
+		bs.direction = direction;													//     .
 		return true;
 	}
+
+	color  eval(const hit_record&, const vec3&, const vec3&) const { return color(0,0,0); }
+	double pdf(const hit_record&, const vec3&, const vec3&) const { return 0; }
+};
+
+/*
+ *  :  emit      
+ * (   ),   .   ,
+ * sample()  .
+*/
+class diffuse_light
+{
+private:
+	color emit;
+public:
+	diffuse_light(const color& emit) : emit(emit) {}
+
+	const color& get_emit() const { return emit; }
+
+	color emitted(const hit_record& rec) const { return rec.front_face ? emit : color(0,0,0); }
+
+	bool sample(const ray&, const hit_record&, sampler&, bsdf_sample&) const { return false; }
+
+	color  eval(const hit_record&, const vec3&, const vec3&) const { return color(0,0,0); }
+	double pdf(const hit_record&, const vec3&, const vec3&) const { return 0; }
+};
+
+using material = std::variant<lambertian, metal, dielectric, diffuse_light>;
+
+/*    (   diffuse_light) */
+inline color emitted(const material& mat, const hit_record& rec)
+{
+	if (const diffuse_light* light = std::get_if<diffuse_light>(&mat)) { return light->emitted(rec); }
+	return color(0,0,0);
+}
+
+/*     mat:      */
+inline bool sample_bsdf(const material& mat, const ray& r_in, const hit_record& rec, sampler& gen, bsdf_sample& bs)
+{
+	RT_COUNT(scatter_calls, 1);
+	RT_COUNT_MATERIAL(mat.index());
+	return std::visit([&](const auto& m) { return m.sample(r_in, rec, gen, bs); }, mat);
+}
+
+/*  BSDF  mat   wo ( )  wi ( ) */
+inline color eval_bsdf(const material& mat, const hit_record& rec, const vec3& wo, const vec3& wi)
+{
+	return std::visit([&](const auto& m) { return m.eval(rec, wo, wi); }, mat);
+}
+
+/* ,   sample_bsdf()   wi */
+inline double bsdf_pdf(const material& mat, const hit_record& rec, const vec3& wo, const vec3& wi)
+{
+	return std::visit([&](const auto& m) { return m.pdf(rec, wo, wi); }, mat);
+}
+
+/*
+ *    mat:  scattered    
+ *  throughput attenuation = f*cos/pdf (. bsdf_sample::weight()).
+*/
+inline bool scatter(const material& mat, const ray& r_in, const hit_record& rec,
+	color& attenuation, ray& scattered, sampler& gen)
+{
+	bsdf_sample bs;
+	if (!sample_bsdf(mat, r_in, rec, gen, bs)) { return false; }
+	attenuation = bs.weight(rec.normal);
+	scattered   = rec.spawn_ray(bs.direction);
+	return true;
+}
+
+/*       material (nullptr -   ) */
+inline const char* material_kind_name(size_t kind)
+{
+	static_assert(std::variant_size_v<material> == 4, "material_kind_name() must name every alternative");
+	switch (kind) {
+	case 0:  return "lambertian";
+	case 1:  return "metal";
+	case 2:  return "dielectric";
+	case 3:  return "diffuse_light";
+	default: return nullptr;
+	}
+}
+
+/*   :       */
+class material_table
+{
+private:
+	std::vector<material> items;
+public:
+	uint32_t add(const material& mat)
+	{
+		items.push_back(mat);
+		return uint32_t(items.size() - 1);
+	}
+
+	const material& operator[](uint32_t index) const { return items[index]; }
+	size_t size() const { return items.size(); }
+	void   clear() { items.clear(); }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,435 @@
+/***********************************************************************************
+*   mesh_loader.h    
+* (triangle_mesh.h)   OBJ  PLY.
+*
+*     BLOCK_SIZE  (stream_reader),   
+*    :        
+*  ,    ,      .
+*    10       120  
+*   24  (double)  ,      OBJ.
+*
+* / OBJ /
+*   v, vt, vn  f;   f   1, 
+*       (-1 -  ).  
+*         . 
+*  (o, g, s, usemtl, mtllib, ...) .     
+*    (UV),  (UV)  .
+*
+* / PLY /
+*    binary_little_endian  binary_big_endian.
+*  vertex -  x, y, z,  nx, ny, nz  u, v (s, t);
+*  face -  vertex_indices (vertex_index).    
+*   .
+***********************************************************************************/
+
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "triangle_mesh.h"
+
+/*     */
+class stream_reader
+{
+private:
+	static const size_t BLOCK_SIZE = size_t(1) << 20;
+
+	std::ifstream     in;
+	std::vector<char> buffer;
+	size_t            pos  = 0;	//     buffer
+	size_t            size = 0;	//    buffer
+	size_t            left = 0;	//  ,     buffer
+
+	/*          */
+	bool refill()
+	{
+		if (!in) { return false; }
+		std::memmove(buffer.data(), buffer.data() + pos, size - pos);
+		size -= pos;
+		pos = 0;
+		if (size == buffer.size()) { buffer.resize(buffer.size() * 2); } //   
+		in.read(buffer.data() + size, std::streamsize(buffer.size() - size));
+		size_t got = size_t(in.gcount());
+		size += got;
+		left -= std::min(left, got);
+		return got > 0;
+	}
+
+public:
+	bool open(const std::string& path)
+	{
+		in.open(path, std::ios::binary | std::ios::ate);
+		buffer.resize(BLOCK_SIZE);
+		pos = size = 0;
+		left = in ? size_t(in.tellg()) : 0;
+		in.seekg(0);
+		return bool(in);
+	}
+
+	/*       */
+	size_t remaining() const { return size - pos + left; }
+
+	/*      ; false    */
+	bool line(std::string_view& out)
+	{
+		for (;;) {
+			const char* start = buffer.data() + pos;
+			const char* nl = static_cast<const char*>(std::memchr(start, '\n', size - pos));
+			if (nl) {
+				size_t length = size_t(nl - start);
+				pos += length + 1;
+				if (length > 0 && start[length - 1] == '\r') { --length; }
+				out = std::string_view(start, length);
+				return true;
+			}
+			if (!refill()) {
+				if (pos == size) { return false; }
+				out = std::string_view(buffer.data() + pos, size - pos); //    '\n'
+				pos = size;
+				return true;
+			}
+		}
+	}
+
+	/*   count  */
+	bool read(void* dst, size_t count)
+	{
+		char* out = static_cast<char*>(dst);
+		while (count > 0) {
+			if (pos == size && !refill()) { return false; }
+			size_t n = std::min(count, size - pos);
+			std::memcpy(out, buffer.data() + pos, n);
+			pos += n;
+			out += n;
+			count -= n;
+		}
+		return true;
+	}
+};
+
+namespace mesh_detail
+{
+	/*    s ( -   ) */
+	inline std::string_view next_word(std::string_view& s)
+	{
+		size_t start = 0;
+		while (start < s.size() && (s[start] == ' ' || s[start] == '\t')) { ++start; }
+		size_t end = start;
+		while (end < s.size() && s[end] != ' ' && s[end] != '\t') { ++end; }
+		std::string_view w = s.substr(start, end - start);
+		s.remove_prefix(end);
+		return w;
+	}
+
+	inline bool parse(std::string_view w, double& value)
+	{
+		auto res = std::from_chars(w.data(), w.data() + w.size(), value);
+		return !w.empty() && res.ec == std::errc() && res.ptr == w.data() + w.size();
+	}
+
+	/*  OBJ ( 1,  -  )     count  */
+	inline bool resolve(std::string_view w, size_t count, uint32_t& index)
+	{
+		long long value = 0;
+		auto res = std::from_chars(w.data(), w.data() + w.size(), value);
+		if (w.empty() || res.ec != std::errc() || res.ptr != w.data() + w.size() || value == 0) { return false; }
+		long long k = value > 0 ? value - 1 : (long long)(count) + value;
+		if (k < 0 || k >= (long long)(count)) { return false; }
+		index = uint32_t(k);
+		return true;
+	}
+}
+
+/*  OBJ  mesh (  );   -   error */
+inline bool load_obj(const std::string& path, triangle_mesh& mesh, std::string& error)
+{
+	using namespace mesh_detail;
+	mesh = triangle_mesh(mesh.get_material());
+
+	stream_reader in;
+	if (!in.open(path)) { error = path + ": cannot read file"; return false; }
+
+	std::vector<uint32_t> corners[3];	//  , UV    
+	bool missing_uvs = false, missing_normals = false;
+	std::string_view s;
+	for (size_t line = 1; in.line(s); ++line) {
+		auto fail = [&](const char* message) {
+			error = path + ":" + std::to_string(line) + ": " + message;
+			return false;
+		};
+		std::string_view key = next_word(s);
+
+		if (key == "v" || key == "vn") {
+			double x, y, z;
+			if (!parse(next_word(s), x) || !parse(next_word(s), y) || !parse(next_word(s), z)) { return fail("bad vector"); }
+			if (key == "v") { mesh.positions.push_back(point3(real(x), real(y), real(z))); }
+			else            { mesh.normals.push_back(vec3(real(x), real(y), real(z))); }
+		}
+		else if (key == "vt") {
+			double u, v = 0;
+			if (!parse(next_word(s), u)) { return fail("bad texture coordinate"); }
+			std::string_view w = next_word(s);
+			if (!w.empty() && !parse(w, v)) { return fail("bad texture coordinate"); }
+			mesh.uvs.push_back({ real(u), real(v) });
+		}
+		else if (key == "f") {
+			for (std::vector<uint32_t>& c : corners) { c.clear(); }
+			bool has_uv = true, has_normal = true;
+			for (std::string_view w = next_word(s); !w.empty(); w = next_word(s)) {
+				// v, v/vt, v//vn  v/vt/vn
+				size_t slash1 = w.find('/');
+				size_t slash2 = slash1 == std::string_view::npos ? slash1 : w.find('/', slash1 + 1);
+				std::string_view wv = w.substr(0, slash1);
+				std::string_view wt = slash1 == std::string_view::npos ? std::string_view() : w.substr(slash1 + 1, slash2 - slash1 - 1);
+				std::string_view wn = slash2 == std::string_view::npos ? std::string_view() : w.substr(slash2 + 1);
+
+				uint32_t k;
+				if (!resolve(wv, mesh.positions.size(), k)) { return fail("bad vertex index"); }
+				corners[0].push_back(k);
+				if (wt.empty()) { has_uv = false; }
+				else if (resolve(wt, mesh.uvs.size(), k)) { corners[1].push_back(k); }
+				else { return fail("bad texture coordinate index"); }
+				if (wn.empty()) { has_normal = false; }
+				else if (resolve(wn, mesh.normals.size(), k)) { corners[2].push_back(k); }
+				else { return fail("bad normal index"); }
+			}
+			if (corners[0].size() < 3) { return fail("face with less than 3 vertices"); }
+			missing_uvs     = missing_uvs || !has_uv;
+			missing_normals = missing_normals || !has_normal;
+
+			for (size_t k = 2; k < corners[0].size(); ++k) {
+				uint32_t v[3] = { corners[0][0], corners[0][k - 1], corners[0][k] };
+				if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2]) { continue; } //  
+				uint32_t t[3], n[3];
+				if (has_uv)     { t[0] = corners[1][0]; t[1] = corners[1][k - 1]; t[2] = corners[1][k]; }
+				if (has_normal) { n[0] = corners[2][0]; n[1] = corners[2][k - 1]; n[2] = corners[2][k]; }
+				mesh.add_triangle(v, has_normal ? n : nullptr, has_uv ? t : nullptr);
+			}
+		}
+	}
+
+	if (missing_uvs || mesh.uvs.empty())         { mesh.uvs.clear(); mesh.uv_indices.clear(); }
+	if (missing_normals || mesh.normals.empty()) { mesh.normals.clear(); mesh.normal_indices.clear(); }
+	mesh.build();
+	return true;
+}
+
+/*   PLY  mesh (  );   -   error */
+inline bool load_ply(const std::string& path, triangle_mesh& mesh, std::string& error)
+{
+	enum class value_type { none, i8, u8, i16, u16, i32, u32, f32, f64 };
+	struct property
+	{
+		std::string name;
+		value_type  type  = value_type::none;
+		value_type  count = value_type::none;	//   , none -  
+	};
+	struct element
+	{
+		std::string           name;
+		size_t                count = 0;
+		std::vector<property> properties;
+	};
+
+	auto type_from_name = [](const std::string& name) {
+		if (name == "char"   || name == "int8")    { return value_type::i8; }
+		if (name == "uchar"  || name == "uint8")   { return value_type::u8; }
+		if (name == "short"  || name == "int16")   { return value_type::i16; }
+		if (name == "ushort" || name == "uint16")  { return value_type::u16; }
+		if (name == "int"    || name == "int32")   { return value_type::i32; }
+		if (name == "uint"   || name == "uint32")  { return value_type::u32; }
+		if (name == "float"  || name == "float32") { return value_type::f32; }
+		if (name == "double" || name == "float64") { return value_type::f64; }
+		return value_type::none;
+	};
+
+	mesh = triangle_mesh(mesh.get_material());
+	auto fail = [&](const std::string& message) {
+		error = path + ": " + message;
+		return false;
+	};
+
+	stream_reader in;
+	if (!in.open(path)) { return fail("cannot read file"); }
+
+	/*  */
+	std::vector<element> elements;
+	bool big_endian = false;
+	std::string_view s;
+	if (!in.line(s) || s != "ply") { return fail("not a PLY file"); }
+	for (;;) {
+		if (!in.line(s)) { return fail("truncated PLY header"); }
+		std::istringstream words{ std::string(s) };
+		std::string key;
+		words >> key;
+		if (key == "end_header") { break; }
+		if (key == "format") {
+			std::string format;
+			words >> format;
+			if (format == "binary_big_endian") { big_endian = true; }
+			else if (format != "binary_little_endian") { return fail("only binary PLY is supported, not '" + format + "'"); }
+		}
+		else if (key == "element") {
+			element e;
+			if (!(words >> e.name >> e.count)) { return fail("bad element declaration"); }
+			elements.push_back(e);
+		}
+		else if (key == "property") {
+			if (elements.empty()) { return fail("property before element"); }
+			property p;
+			std::string type;
+			words >> type;
+			if (type == "list") {
+				std::string count_type;
+				words >> count_type >> type;
+				p.count = type_from_name(count_type);
+				if (p.count == value_type::none || p.count == value_type::f32 || p.count == value_type::f64) {
+					return fail("bad list length type '" + count_type + "'");
+				}
+			}
+			p.type = type_from_name(type);
+			if (!(words >> p.name) || p.type == value_type::none) { return fail("bad property declaration"); }
+			elements.back().properties.push_back(p);
+		}
+		// comment, obj_info     
+	}
+
+	auto type_size = [](value_type type) {
+		return (type == value_type::i8 || type == value_type::u8) ? size_t(1)
+			 : (type == value_type::i16 || type == value_type::u16) ? size_t(2)
+			 : (type == value_type::f64) ? size_t(8) : size_t(4);
+	};
+
+	/*   type  ,   double */
+	auto read_value = [&](value_type type, double& value) {
+		unsigned char bytes[8];
+		size_t size = type_size(type);
+		if (!in.read(bytes, size)) { return false; }
+		if (big_endian) { std::reverse(bytes, bytes + size); }
+		switch (type) {
+		case value_type::i8:  { int8_t   x; std::memcpy(&x, bytes, 1); value = x; break; }
+		case value_type::u8:  { uint8_t  x; std::memcpy(&x, bytes, 1); value = x; break; }
+		case value_type::i16: { int16_t  x; std::memcpy(&x, bytes, 2); value = x; break; }
+		case value_type::u16: { uint16_t x; std::memcpy(&x, bytes, 2); value = x; break; }
+		case value_type::i32: { int32_t  x; std::memcpy(&x, bytes, 4); value = x; break; }
+		case value_type::u32: { uint32_t x; std::memcpy(&x, bytes, 4); value = x; break; }
+		case value_type::f32: { float    x; std::memcpy(&x, bytes, 4); value = x; break; }
+		default:              { double   x; std::memcpy(&x, bytes, 8); value = x; break; }
+		}
+		return true;
+	};
+
+	/*  */
+	std::vector<uint32_t> polygon;
+	bool has_normals = false, has_uvs = false;
+	size_t vertex_count = 0;
+	for (const element& e : elements) {
+		//   : 0..2 - x,y,z, 3..5 - nx,ny,nz, 6,7 - u,v, -1 - 
+		std::vector<int> slot(e.properties.size(), -1);
+		int face_list = -1;
+
+		/*
+		 *         ( 
+		 *   item_size ;  -    ),  
+		 *         .
+		*/
+		size_t item_size = 0;
+		for (const property& p : e.properties) { item_size += type_size(p.count == value_type::none ? p.type : p.count); }
+		if (e.properties.empty()) { continue; }
+		if (e.count > in.remaining() / item_size) { return fail("truncated " + e.name + " data"); }
+		if (e.name == "vertex") {
+			static const char* names[8][3] = {
+				{ "x" }, { "y" }, { "z" }, { "nx" }, { "ny" }, { "nz" },
+				{ "u", "s", "texture_u" }, { "v", "t", "texture_v" } };
+			int found = 0;
+			for (size_t k = 0; k < e.properties.size(); ++k) {
+				for (int n = 0; n < 8 && slot[k] < 0; ++n) {
+					for (const char* name : names[n]) {
+						if (name && e.properties[k].name == name && e.properties[k].count == value_type::none) { slot[k] = n; found |= 1 << n; }
+					}
+				}
+			}
+			if ((found & 7) != 7) { return fail("vertex element without x, y, z"); }
+			has_normals = (found & 0x38) == 0x38;
+			has_uvs     = (found & 0xc0) == 0xc0;
+			vertex_count = e.count;
+			mesh.positions.reserve(e.count);
+			if (has_normals) { mesh.normals.reserve(e.count); }
+			if (has_uvs)     { mesh.uvs.reserve(e.count); }
+		}
+		else if (e.name == "face") {
+			for (size_t k = 0; k < e.properties.size(); ++k) {
+				const property& p = e.properties[k];
+				if ((p.name == "vertex_indices" || p.name == "vertex_index") && p.count != value_type::none) { face_list = int(k); }
+			}
+			if (face_list < 0) { return fail("face element without vertex_indices"); }
+			// :      (       )
+			const property& p = e.properties[size_t(face_list)];
+			size_t triangle_size = item_size + 3 * type_size(p.type);
+			mesh.indices.reserve(size_t(3) * std::min(e.count, in.remaining() / triangle_size));
+		}
+
+		for (size_t item = 0; item < e.count; ++item) {
+			double values[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+			for (size_t k = 0; k < e.properties.size(); ++k) {
+				const property& p = e.properties[k];
+				double value;
+				if (p.count == value_type::none) {
+					if (!read_value(p.type, value)) { return fail("truncated " + e.name + " data"); }
+					if (slot[k] >= 0) { values[slot[k]] = value; }
+					continue;
+				}
+				double length;
+				if (!read_value(p.count, length)) { return fail("truncated " + e.name + " data"); }
+				if (length < 0) { return fail("negative list length in " + e.name + " " + std::to_string(item)); }
+				polygon.clear();
+				for (size_t n = 0; n < size_t(length); ++n) {
+					if (!read_value(p.type, value)) { return fail("truncated " + e.name + " data"); }
+					if (int(k) != face_list) { continue; }
+					//      uint32_t
+					if (!(value >= 0 && value < double(vertex_count))) {
+						return fail("face " + std::to_string(item) + " has bad vertex index");
+					}
+					polygon.push_back(uint32_t(value));
+				}
+				if (int(k) != face_list) { continue; }
+				for (size_t n = 2; n < polygon.size(); ++n) {
+					uint32_t v[3] = { polygon[0], polygon[n - 1], polygon[n] };
+					if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2]) { continue; }
+					mesh.add_triangle(v);
+				}
+			}
+			if (e.name == "vertex") {
+				mesh.positions.push_back(point3(real(values[0]), real(values[1]), real(values[2])));
+				if (has_normals) { mesh.normals.push_back(vec3(real(values[3]), real(values[4]), real(values[5]))); }
+				if (has_uvs)     { mesh.uvs.push_back({ real(values[6]), real(values[7]) }); }
+			}
+		}
+	}
+
+	mesh.build();
+	return true;
+}
+
+/*     .obj  .ply ( ,   ) */
+inline bool load_mesh(const std::string& path, triangle_mesh& mesh, std::string& error)
+{
+	std::string ext = path.substr(path.find_last_of('.') == std::string::npos ? path.size() : path.find_last_of('.'));
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+	if (ext == ".obj") { return load_obj(path, mesh, error); }
+	if (ext == ".ply") { return load_ply(path, mesh, error); }
+	error = path + ": unknown mesh format (expected .obj or .ply)";
+	return false;
+}
+
+#endif
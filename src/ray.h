@@ -16,6 +16,8 @@
 *  ray    orig  dir   .
 *     ray       
 *  orig  dir.
+*
+* ray -  basic_ray<real> (. vec3.h  rt_settings.h).
 ***********************************************************************************/
 
 #ifndef RAY_H
@@ -23,18 +25,21 @@
 
 #include "vec3.h"
 
-class ray
+template <typename T>
+class basic_ray
 {
 private:
-	point3 orig; //(0,0,0) 
-	vec3 dir; //(0,0,0) 
+	basic_vec3<T> orig; //(0,0,0) 
+	basic_vec3<T> dir; //(0,0,0) 
 public:
-	ray() {}
-	ray(const point3& origin, const vec3& direction) : orig(origin), dir(direction) {}
+	basic_ray() {}
+	basic_ray(const basic_vec3<T>& origin, const basic_vec3<T>& direction) : orig(origin), dir(direction) {}
 
-	const point3& origin() const { return orig; }
-	const vec3& direction() const { return dir; }
+	const basic_vec3<T>& origin() const { return orig; }
+	const basic_vec3<T>& direction() const { return dir; }
 
-	point3 at(double t) const { return orig + t*dir;}
+	basic_vec3<T> at(T t) const { return orig + t*dir;}
 };
+
+using ray = basic_ray<real>;
 #endif
\ No newline at end of file
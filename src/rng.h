@@ -0,0 +1,62 @@
+/***********************************************************************************
+*   rng.h     PCG32
+* (permuted congruential generator, M.E. O'Neill).
+*
+*    64-     
+*  (xorshift +  ),    
+*  .    16 ,    
+*   ,       
+*  (   ) ,    
+* .
+*
+*  stream    2^63  . 
+* mix_bits() ( splitmix64)    
+*       (   ).
+***********************************************************************************/
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+inline uint64_t mix_bits(uint64_t v)
+{
+	v ^= v >> 30;
+	v *= 0xbf58476d1ce4e5b9ULL;
+	v ^= v >> 27;
+	v *= 0x94d049bb133111ebULL;
+	v ^= v >> 31;
+	return v;
+}
+
+class rng
+{
+private:
+	uint64_t state;
+	uint64_t inc;   //  ,   -   
+public:
+	rng() : rng(0x853c49e6748fea9bULL, 0xda3e39cb94b95bdbULL) {}
+	rng(uint64_t seed, uint64_t stream = 0) { set_sequence(seed, stream); }
+
+	void set_sequence(uint64_t seed, uint64_t stream)
+	{
+		state = 0;
+		inc   = (stream << 1) | 1u;
+		next_uint();
+		state += seed;
+		next_uint();
+	}
+
+	uint32_t next_uint()
+	{
+		uint64_t old = state;
+		state = old * 6364136223846793005ULL + inc;
+		uint32_t xorshifted = uint32_t(((old >> 18) ^ old) >> 27);
+		uint32_t rot = uint32_t(old >> 59);
+		return (xorshifted >> rot) | (xorshifted << ((~rot + 1) & 31));
+	}
+
+	double next_double() { return next_uint() * 0x1p-32; } //    [0,1)
+};
+
+#endif
@@ -1,15 +1,31 @@
 #ifndef RT_SETTINGS_H
-#define RT_SEGGINGS_H
+#define RT_SETTINGS_H
 
 #include <iostream>
 #include <cmath>
 #include <memory>
 #include <limits>
 #include <cstdlib>
+#include <cstdint>
+
+#include "rng.h"
 
 using std::make_shared;
 using std::shared_ptr;
 
+/*
+ *     (vec3, ray, interval, aabb, ): double
+ *  , float    RT_FLOAT ( ray-tracing-float).  float
+ *            
+ *  ,         .
+ *  ,        double.
+*/
+#ifdef RT_FLOAT
+using real = float;
+#else
+using real = double;
+#endif
+
 /* Constants */
 const double INF = std::numeric_limits<double>::infinity();
 const double PI = 3.1415926535897932385;
@@ -17,13 +33,19 @@ const double PI = 3.1415926535897932385;
 /* Utility Functions */
 inline double degrees_to_radians(double degrees) { return degrees * PI / 180.0; }
 
-inline double random_double() { return std::rand() / (RAND_MAX + 1.0); } //    [0,1)
-inline double random_double(double min, double max) { return min + (max-min)*random_double(); } //    [min, max)
+/*
+ *        rng (. rng.h),   
+ *   :    (, )  
+ * ,        .
+*/
+inline double random_double(rng& gen) { return gen.next_double(); } //    [0,1)
+inline double random_double(rng& gen, double min, double max) { return min + (max-min)*random_double(gen); } //    [min, max)
 
 /* Common Headers */
 #include "color.h"
 #include "ray.h"
 #include "interval.h"
 #include "vec3.h"
+#include "sampling.h"
 
 #endif
\ No newline at end of file
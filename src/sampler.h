@@ -0,0 +1,231 @@
+/***********************************************************************************
+*   sampler.h      
+* () -  sampler, -     (sampler_type):
+*
+* > independent -    rng ( );
+* > stratified  -  (jittered):    
+*                      ,    ;
+* > sobol       -      (hash-based Owen
+*                 scrambling, B. Burley, "Practical Hash-based Owen Scrambling", 2020).
+*
+*        ,   , 
+*        :
+*
+*     0,1 -   ;  2,3 -   ;
+*     4 + 8*b + (0,1) -     b;
+*     4 + 8*b + 2     -     (dielectric);
+*     4 + 8*b + 3     -  ;
+*     4 + 8*b + 4     -    (light.h);
+*     4 + 8*b + (5,6) -   .
+*
+*       (   2D)  
+* ,        .   
+*         , 
+*     (, , SEED) - "padding" 
+* Burley.      
+* ( , "Correlated Multi-Jittered Sampling", 2013).
+*
+*   :  n    
+*  n,      ,    .
+*          count 
+* (camera::STRATA,   SAMPLES_PER_PIXEL);     
+*  ,    ,    count 
+*     (index % count).    count, 
+*  ,     , 
+* count   (checkpoint.h)      
+*   STRATA,    SAMPLES_PER_PIXEL.
+***********************************************************************************/
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "rt_settings.h"
+
+enum class sampler_type { independent, stratified, sobol };
+
+inline const char* sampler_type_name(sampler_type type)
+{
+	switch (type) {
+	case sampler_type::stratified: return "stratified";
+	case sampler_type::sobol:      return "sobol";
+	default:                       return "independent";
+	}
+}
+
+/*   , false -   */
+inline bool sampler_type_from_name(const std::string& name, sampler_type& type)
+{
+	if (name == "independent") { type = sampler_type::independent; return true; }
+	if (name == "stratified")  { type = sampler_type::stratified;  return true; }
+	if (name == "sobol")       { type = sampler_type::sobol;       return true; }
+	return false;
+}
+
+namespace sampler_detail
+{
+	inline uint32_t reverse_bits(uint32_t x)
+	{
+		x = (x << 16) | (x >> 16);
+		x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+		x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+		x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+		x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+		return x;
+	}
+
+	/*      */
+	inline uint32_t sobol_0(uint32_t index) { return reverse_bits(index); }
+
+	inline uint32_t sobol_1(uint32_t index)
+	{
+		//    : v[0] = 2^31, v[k] = v[k-1] ^ (v[k-1] >> 1)
+		uint32_t result = 0;
+		for (uint32_t v = 0x80000000u; index != 0; index >>= 1, v ^= v >> 1) {
+			if (index & 1) { result ^= v; }
+		}
+		return result;
+	}
+
+	/*
+	 *  :         
+	 * .  -      ,  
+	 *      .
+	*/
+	inline uint32_t laine_karras_permutation(uint32_t x, uint32_t seed)
+	{
+		x += seed;
+		x ^= x * 0x6c50b47cu;
+		x ^= x * 0xb82f1e52u;
+		x ^= x * 0xc7afe638u;
+		x ^= x * 0x8d22f6e6u;
+		return x;
+	}
+
+	inline uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed)
+	{
+		return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+	}
+
+	/*   [0, length)   seed,   i (Kensler, 2013) */
+	inline uint32_t permute(uint32_t i, uint32_t length, uint32_t seed)
+	{
+		uint32_t w = length - 1;
+		w |= w >> 1;
+		w |= w >> 2;
+		w |= w >> 4;
+		w |= w >> 8;
+		w |= w >> 16;
+		do {
+			i ^= seed;
+			i *= 0xe170893du;
+			i ^= seed >> 16;
+			i ^= (i & w) >> 4;
+			i ^= seed >> 8;
+			i *= 0x0929eb3fu;
+			i ^= seed >> 23;
+			i ^= (i & w) >> 1;
+			i *= 1 | seed >> 27;
+			i *= 0x6935fa69u;
+			i ^= (i & w) >> 11;
+			i *= 0x74dcb303u;
+			i ^= (i & w) >> 2;
+			i *= 0x9e501cc3u;
+			i ^= (i & w) >> 2;
+			i *= 0xc860a3dfu;
+			i &= w;
+			i ^= i >> 5;
+		} while (i >= length);
+		return (i + seed) % length;
+	}
+
+	inline double to_unit(uint32_t x) { return x * 0x1p-32; }
+}
+
+/*
+ *    sample  pixel.  independent  
+ *  gen,         
+ * (stratified).       ;
+ * start_bounce()       .
+*/
+class sampler
+{
+private:
+	sampler_type type  = sampler_type::independent;
+	uint32_t     index = 0;		//    
+	uint32_t     count = 1;		//    (stratified)
+	uint32_t     seed  = 0;		//    SEED
+	uint32_t     dimension = 0;
+	rng          gen;
+
+	uint32_t dimension_seed(uint32_t d) const { return uint32_t(mix_bits((uint64_t(seed) << 32) | d)); }
+public:
+	static const uint32_t PIXEL_DIMENSION  = 0;
+	static const uint32_t LENS_DIMENSION   = 2;
+	static const uint32_t BOUNCE_DIMENSION = 4;	//    
+	static const uint32_t BOUNCE_STRIDE    = 8;	//   
+
+	sampler() {}
+	explicit sampler(const rng& gen) : gen(gen) {}
+	sampler(sampler_type type, uint64_t pixel_seed, int sample, int strata, const rng& gen)
+		: type(type), index(uint32_t(sample)), count(uint32_t(std::max(1, strata))),
+		  seed(uint32_t(mix_bits(pixel_seed))), gen(gen) {}
+
+	void start_bounce(int bounce)   { dimension = BOUNCE_DIMENSION + BOUNCE_STRIDE * uint32_t(bounce); }
+	void start_roulette(int bounce) { dimension = BOUNCE_DIMENSION + BOUNCE_STRIDE * uint32_t(bounce) + 3; }
+	void start_light(int bounce)    { dimension = BOUNCE_DIMENSION + BOUNCE_STRIDE * uint32_t(bounce) + 4; }
+	void set_dimension(uint32_t d) { dimension = d; }
+
+	double get_1d()
+	{
+		uint32_t d = dimension++;
+		switch (type) {
+		case sampler_type::stratified: {
+			uint32_t stratum = sampler_detail::permute(index % count, count, dimension_seed(d));
+			return (stratum + gen.next_double()) / count;
+		}
+		case sampler_type::sobol: {
+			uint32_t s = dimension_seed(d);
+			uint32_t i = sampler_detail::nested_uniform_scramble(index, s);
+			return sampler_detail::to_unit(sampler_detail::nested_uniform_scramble(sampler_detail::sobol_0(i), s ^ 0x9e3779b9u));
+		}
+		default:
+			return gen.next_double();
+		}
+	}
+
+	sample2 get_2d()
+	{
+		uint32_t d = dimension;
+		dimension += 2;
+		switch (type) {
+		case sampler_type::stratified: {
+			//  nx x ny     count ;    
+			uint32_t nx = uint32_t(std::ceil(std::sqrt(double(count))));
+			uint32_t ny = (count + nx - 1) / nx;
+			uint32_t cell = sampler_detail::permute(index % count, nx * ny, dimension_seed(d));
+			double u = (cell % nx + gen.next_double()) / nx;
+			double v = (cell / nx + gen.next_double()) / ny;
+			return sample2(u, v);
+		}
+		case sampler_type::sobol: {
+			uint32_t s = dimension_seed(d);
+			uint32_t i = sampler_detail::nested_uniform_scramble(index, s);
+			uint32_t x = sampler_detail::nested_uniform_scramble(sampler_detail::sobol_0(i), uint32_t(mix_bits(s + 1)));
+			uint32_t y = sampler_detail::nested_uniform_scramble(sampler_detail::sobol_1(i), uint32_t(mix_bits(s + 2)));
+			return sample2(sampler_detail::to_unit(x), sampler_detail::to_unit(y));
+		}
+		default: {
+			double u = gen.next_double();
+			double v = gen.next_double();
+			return sample2(u, v);
+		}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,194 @@
+/***********************************************************************************
+*   sampling.h   (warps) 
+*    [0,1)^2      
+* :
+*
+* > sample_uniform_sphere()     -    ;
+* > sample_uniform_hemisphere() -    z >= 0;
+* > sample_cosine_hemisphere()  -     cos(theta)/PI;
+* > sample_concentric_disk()    -    , 
+*                                 - (  -> ).
+*
+*  random_unit_vector()  random_in_unit_disk()   :
+*    () ,      (),
+* -    ~48% (~21%) ,    
+* ,   .      
+*       , :
+*
+* >        rng,     
+*    :     ;
+* >       ( *_batch()).
+*
+*    std::sin()/std::cos(),   (sincos_octant(),
+* sincos_turn()):      ,  
+*     ,     .
+*
+*      (pdf)     
+* .         (z -
+* )      onb::to_world().
+***********************************************************************************/
+
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <cmath>
+#include <cstddef>
+
+/*   [0,1)^2 -     */
+struct sample2
+{
+	double u = 0;
+	double v = 0;
+
+	sample2() {}
+	sample2(double u, double v) : u(u), v(v) {}
+
+	static sample2 random(rng& gen)
+	{
+		double u = random_double(gen);
+		double v = random_double(gen);
+		return sample2(u, v);
+	}
+};
+
+/*
+ * sin(x)  cos(x)  |x| <= PI/4:    x^15  x^16 ( ),
+ *    1e-16.
+*/
+inline void sincos_octant(double x, double& s, double& c)
+{
+	double x2 = x * x;
+	s = x * (1 + x2 * (-1.0/6 + x2 * (1.0/120 + x2 * (-1.0/5040 + x2 * (1.0/362880 + x2 * (-1.0/39916800 
+		  + x2 * (1.0/6227020800 + x2 * (-1.0/1307674368000))))))));
+	c = 1 + x2 * (-1.0/2 + x2 * (1.0/24 + x2 * (-1.0/720 + x2 * (1.0/40320 + x2 * (-1.0/3628800 
+		  + x2 * (1.0/479001600 + x2 * (-1.0/87178291200 + x2 * (1.0/20922789888000))))))));
+}
+
+/*
+ * sin  cos  phi = 2*PI*t, t  [0,1].  x = phi - PI   [-PI, PI], 
+ * x/4   sincos_octant()   :
+ * sin 2a = 2 sin a cos a, cos 2a = cos^2 a - sin^2 a.  sin phi = -sin x, cos phi = -cos x.
+*/
+inline void sincos_turn(double t, double& s, double& c)
+{
+	double sa, ca;
+	sincos_octant((t - 0.5) * (PI / 2), sa, ca);
+	double s2 = 2 * sa * ca, c2 = ca * ca - sa * sa;
+	s = -2 * s2 * c2;
+	c = s2 * s2 - c2 * c2;
+}
+
+/*    : z = 1 - 2u,  2*PI*v */
+inline vec3 sample_uniform_sphere(const sample2& s)
+{
+	double z = 1 - 2 * s.u;
+	double r = std::sqrt(std::fmax(0.0, 1 - z*z));
+	double sin_phi, cos_phi;
+	sincos_turn(s.v, sin_phi, cos_phi);
+	return vec3(real(r * cos_phi), real(r * sin_phi), real(z));
+}
+
+inline double uniform_sphere_pdf() { return 1 / (4 * PI); }
+
+/*     z >= 0 */
+inline vec3 sample_uniform_hemisphere(const sample2& s)
+{
+	double z = s.u;
+	double r = std::sqrt(std::fmax(0.0, 1 - z*z));
+	double sin_phi, cos_phi;
+	sincos_turn(s.v, sin_phi, cos_phi);
+	return vec3(real(r * cos_phi), real(r * sin_phi), real(z));
+}
+
+inline double uniform_hemisphere_pdf() { return 1 / (2 * PI); }
+
+/*
+ *      1 (z = 0).  [-1,1]^2  
+ *   ,      
+ *    .    r = sqrt(u)  
+ *      ,     .
+ *   -  ,   .  theta 
+ * x = (PI/4)*ratio  PI/2 - x,  cos  sin theta -  cos  sin x,
+ *    .
+*/
+inline vec3 sample_concentric_disk(const sample2& s)
+{
+	double a = 2 * s.u - 1;
+	double b = 2 * s.v - 1;
+
+	bool   horizontal = std::fabs(a) > std::fabs(b);
+	double r = horizontal ? a : b;
+	double q = horizontal ? b : a;
+	double ratio = q / (r != 0 ? r : 1);	//  r == 0  q == 0,  -  
+	double sin_x, cos_x;
+	sincos_octant((PI / 4) * ratio, sin_x, cos_x);
+	double cos_theta = horizontal ? cos_x : sin_x;
+	double sin_theta = horizontal ? sin_x : cos_x;
+	return vec3(real(r * cos_theta), real(r * sin_theta), 0);
+}
+
+inline double concentric_disk_pdf() { return 1 / PI; }
+
+/*
+ *      cos(theta)/PI ( ): 
+ *     , z = sqrt(1 - x^2 - y^2).
+*/
+inline vec3 sample_cosine_hemisphere(const sample2& s)
+{
+	vec3 d = sample_concentric_disk(s);
+	double z = std::sqrt(std::fmax(0.0, 1 - double(d.x())*d.x() - double(d.y())*d.y()));
+	return vec3(d.x(), d.y(), real(z));
+}
+
+inline double cosine_hemisphere_pdf(double cos_theta) { return cos_theta > 0 ? cos_theta / PI : 0; }
+
+/*   : out[k] = warp(samples[k]) */
+template <typename Warp>
+inline void sample_batch(Warp warp, const sample2* samples, vec3* out, size_t count)
+{
+	for (size_t k = 0; k < count; ++k) { out[k] = warp(samples[k]); }
+}
+
+inline void sample_uniform_sphere_batch(const sample2* s, vec3* out, size_t n)     { sample_batch(sample_uniform_sphere, s, out, n); }
+inline void sample_uniform_hemisphere_batch(const sample2* s, vec3* out, size_t n) { sample_batch(sample_uniform_hemisphere, s, out, n); }
+inline void sample_cosine_hemisphere_batch(const sample2* s, vec3* out, size_t n)  { sample_batch(sample_cosine_hemisphere, s, out, n); }
+inline void sample_concentric_disk_batch(const sample2* s, vec3* out, size_t n)    { sample_batch(sample_concentric_disk, s, out, n); }
+
+/*
+ *   (u, v, w)  w = n, n -  .  
+ *    n.z (Duff et al., "Building an Orthonormal Basis, Revisited").
+*/
+class onb
+{
+private:
+	vec3 axis[3];
+public:
+	explicit onb(const vec3& n)
+	{
+		real sign = std::copysign(real(1), n.z());
+		real a = -1 / (sign + n.z());
+		real b = n.x() * n.y() * a;
+		axis[0] = vec3(1 + sign * n.x() * n.x() * a, sign * b, -sign * n.x());
+		axis[1] = vec3(b, sign + n.y() * n.y() * a, -n.y());
+		axis[2] = n;
+	}
+
+	const vec3& u() const { return axis[0]; }
+	const vec3& v() const { return axis[1]; }
+	const vec3& w() const { return axis[2]; }
+
+	/*      (x, y, z)    */
+	vec3 to_world(const vec3& a) const { return a.x() * axis[0] + a.y() * axis[1] + a.z() * axis[2]; }
+};
+
+/*        rng */
+inline vec3 random_unit_vector(rng& gen) { return sample_uniform_sphere(sample2::random(gen)); }
+
+inline vec3 random_on_hemisphere(rng& gen, const vec3& normal)
+{
+	return onb(normal).to_world(sample_uniform_hemisphere(sample2::random(gen)));
+}
+
+inline vec3 random_in_unit_disk(rng& gen) { return sample_concentric_disk(sample2::random(gen)); }
+
+#endif
@@ -0,0 +1,770 @@
+/***********************************************************************************
+*   scene.h    (, , )
+*          .
+*
+* /   /
+*    , '#'     :
+*
+*     aspect_ratio 1.7777777777777777     #   ( camera)
+*     image_width 1920
+*     samples_per_pixel 500
+*     max_depth 50
+*     vfov 20
+*     lookfrom 13 2 3
+*     lookat 0 0 0
+*     vup 0 1 0
+*     focus_angle 0.6
+*     focus_dist 10
+*     sky_brightness 1                    #   
+*     lambertian ground 0.5 0.5 0.5       # :   
+*     metal      mirror 0.7 0.6 0.5 0.0   # albedo  fuzz
+*     dielectric glass 1.5                #  
+*     diffuse_light lamp 20 20 20         #   ( )
+*     sphere 0 -1000 0 1000 ground        # , ,  
+*     mesh bunny.ply ground               #     OBJ  PLY
+*     object tree                         #    
+*     sphere 0 1 0 0.5 ground             #         
+*     end                                 #  
+*     instance tree scale 2 2 2 rotate 0 1 0 30 translate 4 0 1
+*
+*         .  
+*     .      
+*    (. mesh_loader.h).    diffuse_light
+* ,        (light.h -  ).
+*
+*  (object ... end)     :   
+*  (instance.h),       
+* .      :
+* translate x y z, scale sx sy sz, rotate ax ay az  ( ) 
+* matrix - 12    3x4.      
+* ,        .
+*
+* /   (little-endian) /
+*     "RTSB" | version u32 |
+*     aspect_ratio f64 | image_width i32 | samples_per_pixel i32 | max_depth i32 |
+*     vfov f64 | lookfrom 3*f64 | lookat 3*f64 | vup 3*f64 | focus_angle f64 |
+*     focus_dist f64 | sky_brightness f64 (  2) |
+*     material count u32 | count * (type u32 | 4*f64 ) |
+*     sphere count u32   | count * (center 3*f64 | radius f64 | material u32 | pad u32) |
+*     mesh count u32     | count * (material u32 | length u32 |  length ) (  3) |
+*     object count u32   | count * (       ) (  4) |
+*     instance count u32 | count * (object u32 | pad u32 | 12*f64  | 12*f64  )
+*
+* type -   material (0 - lambertian, 1 - metal, 2 - dielectric,
+* 3 - diffuse_light), : albedo  fuzz, albedo  0, refraction_index  ,
+* emit  0.   1   sky_brightness = 1.  
+*   ,     ( - ).
+*       :    
+*     .
+*
+*      spheres,   world()   
+*    ,        .
+*  ,   scene     spheres.
+*     (instances),  -  shared_ptr, ..
+*    .
+***********************************************************************************/
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "camera.h"
+#include "hittable_list.h"
+#include "instance.h"
+#include "material.h"
+#include "mesh_loader.h"
+#include "sphere.h"
+#include "triangle_mesh.h"
+
+class scene
+{
+private:
+	static const uint32_t VERSION = 4;
+
+	/*     */
+	struct sphere_record
+	{
+		double   center[3];
+		double   radius;
+		uint32_t mat;
+		uint32_t pad;
+	};
+	static_assert(sizeof(sphere_record) == 40, "sphere_record must match the file layout");
+
+	/*     */
+	struct instance_record
+	{
+		uint32_t object;
+		uint32_t pad;
+		double   forward[12];
+		double   inverse[12];
+	};
+	static_assert(sizeof(instance_record) == 200, "instance_record must match the file layout");
+
+	/*        */
+	struct text_cursor
+	{
+		const char* p;
+		const char* end;
+		int         line = 1;
+
+		/*     (   ) */
+		std::string_view word()
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) { ++p; }
+			if (p < end && *p == '#') { while (p < end && *p != '\n') { ++p; } }
+			const char* start = p;
+			while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' && *p != '#') { ++p; }
+			return std::string_view(start, size_t(p - start));
+		}
+
+		bool number(double& value)
+		{
+			std::string_view w = word();
+			auto res = std::from_chars(w.data(), w.data() + w.size(), value);
+			return !w.empty() && res.ec == std::errc() && res.ptr == w.data() + w.size();
+		}
+
+		bool number(int& value)
+		{
+			std::string_view w = word();
+			auto res = std::from_chars(w.data(), w.data() + w.size(), value);
+			return !w.empty() && res.ec == std::errc() && res.ptr == w.data() + w.size();
+		}
+
+		bool vector(vec3& v)
+		{
+			double x, y, z;
+			if (!number(x) || !number(y) || !number(z)) { return false; }
+			v = vec3(x, y, z);
+			return true;
+		}
+
+		/*    ; false,      */
+		bool end_line()
+		{
+			bool clean = word().empty();
+			while (p < end && *p != '\n') { ++p; }
+			if (p < end) { ++p; ++line; }
+			return clean;
+		}
+	};
+
+	bool fail(const std::string& message)
+	{
+		error = message;
+		return false;
+	}
+
+	static bool read_file(const std::string& path, std::string& data)
+	{
+		std::ifstream in(path, std::ios::binary);
+		if (!in) { return false; }
+		in.seekg(0, std::ios::end);
+		data.resize(size_t(in.tellg()));
+		in.seekg(0, std::ios::beg);
+		in.read(&data[0], std::streamsize(data.size()));
+		return bool(in);
+	}
+
+	/*
+	 *   file (    scene_path)  
+	 * mat   target,    -   paths.
+	*/
+	bool add_mesh(const std::string& scene_path, const std::string& file, uint32_t mat,
+		std::vector<triangle_mesh>& target, std::vector<std::string>& paths)
+	{
+		std::filesystem::path resolved = std::filesystem::path(scene_path).parent_path() / std::filesystem::path(file);
+		std::string mesh_error;
+		target.emplace_back(mat);
+		if (!load_mesh(resolved.string(), target.back(), mesh_error)) { return fail(mesh_error); }
+		paths.push_back(resolved.string());
+		return true;
+	}
+
+	/*
+	 *       (camera::SCENE_FINGERPRINT) 
+	 * samples_per_pixel:       ,
+	 *   .     .
+	*/
+	static uint64_t fingerprint(const std::string& data)
+	{
+		const size_t spp_offset = 20; // samples_per_pixel     (. save_binary())
+		if (data.compare(0, 4, "RTSB") == 0 && data.size() >= spp_offset + sizeof(int32_t)) {
+			uint64_t h = fingerprint_bytes(data.data(), spp_offset);
+			return fingerprint_bytes(data.data() + spp_offset + sizeof(int32_t), data.size() - spp_offset - sizeof(int32_t), h);
+		}
+		uint64_t h = FINGERPRINT_BASIS;
+		for (size_t start = 0; start < data.size();) {
+			size_t end = data.find('\n', start);
+			end = (end == std::string::npos) ? data.size() : end + 1;
+			std::string_view line(data.data() + start, end - start);
+			size_t first = line.find_first_not_of(" \t");
+			if (first == std::string_view::npos || line.compare(first, 17, "samples_per_pixel") != 0) {
+				h = fingerprint_bytes(line.data(), line.size(), h);
+			}
+			start = end;
+		}
+		return h;
+	}
+
+	/*
+	 *   :     ,
+	 *     ..     
+	 *   NaN.     nullptr.
+	*/
+	static const char* camera_error(const camera& c)
+	{
+		if (!(c.ASPECT_RATIO > 0))     { return "bad value for 'aspect_ratio' (must be positive)"; }
+		if (c.IMAGE_WIDTH <= 0)        { return "bad value for 'image_width' (must be positive)"; }
+		if (c.SAMPLES_PER_PIXEL <= 0)  { return "bad value for 'samples_per_pixel' (must be positive)"; }
+		if (c.MAX_DEPTH < 0)           { return "bad value for 'max_depth' (must not be negative)"; }
+		return nullptr;
+	}
+
+	/*       (  ) */
+	static bool parse_transform(text_cursor& in, transform& result, std::string& message)
+	{
+		result = transform();
+		for (std::string_view op = in.word(); !op.empty(); op = in.word()) {
+			transform step;
+			vec3 v; double value;
+			if (op == "translate") {
+				if (!in.vector(v)) { message = "bad or missing value for 'translate'"; return false; }
+				step = transform::translate(v);
+			}
+			else if (op == "scale") {
+				if (!in.vector(v)) { message = "bad or missing value for 'scale'"; return false; }
+				if (v.x() == 0 || v.y() == 0 || v.z() == 0) { message = "zero scale"; return false; }
+				step = transform::scale(v);
+			}
+			else if (op == "rotate") {
+				if (!in.vector(v) || !in.number(value)) { message = "bad or missing value for 'rotate'"; return false; }
+				if (v.length_squared() == 0) { message = "zero rotation axis"; return false; }
+				step = transform::rotate(v, value);
+			}
+			else if (op == "matrix") {
+				double values[12];
+				for (double& x : values) {
+					if (!in.number(x)) { message = "bad or missing value for 'matrix'"; return false; }
+				}
+				if (!transform::from_matrix(values, step)) { message = "singular matrix"; return false; }
+			}
+			else { message = "unknown transform '" + std::string(op) + "'"; return false; }
+			result = step * result;
+		}
+		return true;
+	}
+
+	bool parse_text(const std::string& path, const std::string& data)
+	{
+		std::unordered_map<std::string_view, uint32_t> names; //   (  data)
+		std::unordered_map<std::string_view, uint32_t> object_names;
+		geometry_group* current = nullptr;	//   object  end
+		text_cursor in{ data.data(), data.data() + data.size() };
+
+		//      ,    .
+		spheres.reserve(size_t(std::count(data.begin(), data.end(), '\n')) + 1);
+
+		while (in.p < in.end) {
+			int line = in.line;
+			auto where = [&]() { return path + ":" + std::to_string(line) + ": "; };
+			std::string_view key = in.word();
+			bool ok = true;
+
+			if (key.empty()) {}
+			else if (key == "sphere") {
+				vec3 center; double radius;
+				ok = in.vector(center) && in.number(radius);
+				if (ok) {
+					auto it = names.find(in.word());
+					if (it == names.end()) { return fail(where() + "unknown material"); }
+					(current ? current->spheres : spheres).emplace_back(center, radius, it->second);
+				}
+			}
+			else if (key == "mesh") {
+				std::string_view file = in.word();
+				ok = !file.empty();
+				if (ok) {
+					auto it = names.find(in.word());
+					if (it == names.end()) { return fail(where() + "unknown material"); }
+					bool added = current ? add_mesh(path, std::string(file), it->second, current->meshes, current->mesh_paths)
+										 : add_mesh(path, std::string(file), it->second, meshes, mesh_paths);
+					if (!added) { return fail(where() + error); }
+				}
+			}
+			else if (key == "object") {
+				std::string_view name = in.word();
+				if (name.empty()) { return fail(where() + "object name expected"); }
+				if (current) { return fail(where() + "nested objects are not supported"); }
+				objects.push_back(make_shared<geometry_group>());
+				current = objects.back().get();
+				object_names[name] = uint32_t(objects.size() - 1);
+			}
+			else if (key == "end") {
+				if (!current) { return fail(where() + "'end' without 'object'"); }
+				current->build();
+				current = nullptr;
+			}
+			else if (key == "instance") {
+				if (current) { return fail(where() + "instance inside an object"); }
+				auto it = object_names.find(in.word());
+				if (it == object_names.end()) { return fail(where() + "unknown object"); }
+				transform to_world;
+				std::string message;
+				if (!parse_transform(in, to_world, message)) { return fail(where() + message); }
+				instances.emplace_back(objects[it->second], to_world);
+			}
+			else if (key == "lambertian" || key == "metal" || key == "dielectric" || key == "diffuse_light") {
+				std::string_view name = in.word();
+				if (name.empty()) { return fail(where() + "material name expected"); }
+				vec3 albedo; double param = 0;
+				if (key == "lambertian") {
+					ok = in.vector(albedo);
+					if (ok) { names[name] = materials.add(lambertian(albedo)); }
+				}
+				else if (key == "metal") {
+					ok = in.vector(albedo) && in.number(param);
+					if (ok) { names[name] = materials.add(metal(albedo, param)); }
+				}
+				else if (key == "diffuse_light") {
+					ok = in.vector(albedo);
+					if (ok) { names[name] = materials.add(diffuse_light(albedo)); }
+				}
+				else {
+					ok = in.number(param);
+					if (ok) { names[name] = materials.add(dielectric(param)); }
+				}
+			}
+			else if (key == "aspect_ratio")      { ok = in.number(cam.ASPECT_RATIO); }
+			else if (key == "image_width")       { ok = in.number(cam.IMAGE_WIDTH); }
+			else if (key == "samples_per_pixel") { ok = in.number(cam.SAMPLES_PER_PIXEL); }
+			else if (key == "max_depth")         { ok = in.number(cam.MAX_DEPTH); }
+			else if (key == "vfov")              { ok = in.number(cam.VFOV); }
+			else if (key == "lookfrom")          { ok = in.vector(cam.LOOKFROM); }
+			else if (key == "lookat")            { ok = in.vector(cam.LOOKAT); }
+			else if (key == "vup")               { ok = in.vector(cam.VUP); }
+			else if (key == "focus_angle")       { ok = in.number(cam.FOCUS_ANGLE); }
+			else if (key == "focus_dist")        { ok = in.number(cam.FOCUS_DIST); }
+			else if (key == "sky_brightness")    { ok = in.number(cam.SKY_BRIGHTNESS); }
+			else { return fail(where() + "unknown directive '" + std::string(key) + "'"); }
+
+			if (!ok) { return fail(where() + "bad or missing value for '" + std::string(key) + "'"); }
+			if (const char* bad = camera_error(cam)) { return fail(where() + bad); }
+			if (!in.end_line()) { return fail(where() + "unexpected text after '" + std::string(key) + "'"); }
+		}
+		if (current) { return fail(path + ": object is not closed with 'end'"); }
+		return true;
+	}
+
+	bool parse_binary(const std::string& path, const std::string& data)
+	{
+		const char* p   = data.data();
+		const char* end = data.data() + data.size();
+		auto read = [&](void* dst, size_t size) {
+			if (size_t(end - p) < size) { return false; }
+			std::memcpy(dst, p, size);
+			p += size;
+			return true;
+		};
+
+		char magic[4];
+		uint32_t version = 0;
+		if (!read(magic, 4) || !read(&version, sizeof(version)) || std::memcmp(magic, "RTSB", 4) != 0 
+			|| version < 1 || version > VERSION) {
+			return fail(path + ": not a binary scene of version 1.." + std::to_string(VERSION));
+		}
+
+		double v[3];
+		bool ok = read(&cam.ASPECT_RATIO, sizeof(double)) && read(&cam.IMAGE_WIDTH, sizeof(int32_t))
+			&& read(&cam.SAMPLES_PER_PIXEL, sizeof(int32_t)) && read(&cam.MAX_DEPTH, sizeof(int32_t))
+			&& read(&cam.VFOV, sizeof(double));
+		if (ok && (ok = read(v, sizeof(v)))) { cam.LOOKFROM = point3(v[0], v[1], v[2]); }
+		if (ok && (ok = read(v, sizeof(v)))) { cam.LOOKAT   = point3(v[0], v[1], v[2]); }
+		if (ok && (ok = read(v, sizeof(v)))) { cam.VUP      = vec3(v[0], v[1], v[2]); }
+		ok = ok && read(&cam.FOCUS_ANGLE, sizeof(double)) && read(&cam.FOCUS_DIST, sizeof(double));
+		if (version >= 2) { ok = ok && read(&cam.SKY_BRIGHTNESS, sizeof(double)); }
+		if (!ok) { return fail(path + ": truncated file"); }
+		if (const char* bad = camera_error(cam)) { return fail(path + ": " + bad); }
+
+		uint32_t count = 0;
+		ok = ok && read(&count, sizeof(count));
+		for (uint32_t m = 0; ok && m < count; ++m) {
+			uint32_t type;
+			double   param[4];
+			ok = read(&type, sizeof(type)) && read(param, sizeof(param));
+			if (!ok) { break; }
+			color albedo(param[0], param[1], param[2]);
+			if      (type == 0) { materials.add(lambertian(albedo)); }
+			else if (type == 1) { materials.add(metal(albedo, param[3])); }
+			else if (type == 2) { materials.add(dielectric(param[0])); }
+			else if (type == 3) { materials.add(diffuse_light(albedo)); }
+			else { return fail(path + ": unknown material type " + std::to_string(type)); }
+		}
+
+		if (!ok) { return fail(path + ": truncated file"); }
+
+		/*       */
+		auto read_primitives = [&](std::vector<sphere>& out_spheres, std::vector<triangle_mesh>& out_meshes,
+			std::vector<std::string>& out_paths) {
+			uint32_t n = 0;
+			if (!read(&n, sizeof(n)) || size_t(end - p) < size_t(n) * sizeof(sphere_record)) { return fail(path + ": truncated file"); }
+
+			const sphere_record* records = reinterpret_cast<const sphere_record*>(p);
+			out_spheres.reserve(n);
+			for (uint32_t k = 0; k < n; ++k) {
+				sphere_record rec;
+				std::memcpy(&rec, records + k, sizeof(rec)); //      
+				if (rec.mat >= materials.size()) { return fail(path + ": sphere " + std::to_string(k) + " has bad material index"); }
+				out_spheres.emplace_back(point3(rec.center[0], rec.center[1], rec.center[2]), rec.radius, rec.mat);
+			}
+			p += size_t(n) * sizeof(sphere_record);
+
+			if (version < 3) { return true; }
+			if (!read(&n, sizeof(n))) { return fail(path + ": truncated file"); }
+			for (uint32_t k = 0; k < n; ++k) {
+				uint32_t mat, length;
+				if (!read(&mat, sizeof(mat)) || !read(&length, sizeof(length)) || size_t(end - p) < length) {
+					return fail(path + ": truncated file");
+				}
+				std::string file(p, length);
+				p += length;
+				if (mat >= materials.size()) { return fail(path + ": mesh " + std::to_string(k) + " has bad material index"); }
+				if (!add_mesh(path, file, mat, out_meshes, out_paths)) { return false; }
+			}
+			return true;
+		};
+
+		if (!read_primitives(spheres, meshes, mesh_paths)) { return false; }
+		if (version < 4) { return true; }
+
+		if (!read(&count, sizeof(count))) { return fail(path + ": truncated file"); }
+		for (uint32_t k = 0; k < count; ++k) {
+			objects.push_back(make_shared<geometry_group>());
+			if (!read_primitives(objects.back()->spheres, objects.back()->meshes, objects.back()->mesh_paths)) { return false; }
+			objects.back()->build();
+		}
+
+		if (!read(&count, sizeof(count)) || size_t(end - p) < size_t(count) * sizeof(instance_record)) {
+			return fail(path + ": truncated file");
+		}
+		instances.reserve(count);
+		for (uint32_t k = 0; k < count; ++k) {
+			instance_record rec;
+			read(&rec, sizeof(rec));
+			if (rec.object >= objects.size()) { return fail(path + ": instance " + std::to_string(k) + " has bad object index"); }
+			instances.emplace_back(objects[rec.object], transform::from_matrices(rec.forward, rec.inverse));
+		}
+		return true;
+	}
+
+public:
+	camera              cam;		//      (  -  )
+	material_table      materials;
+	std::vector<sphere> spheres;
+	std::vector<triangle_mesh> meshes;
+	std::vector<std::string>   mesh_paths;	//   meshes
+	std::vector<shared_ptr<geometry_group>> objects;	//   
+	std::vector<instance>      instances;
+	double              load_ms = 0;	//     
+	std::string         error;		//    
+
+	/*
+	 *     path.     "RTSB"
+	 *  ,     .  
+	 *  .    false,  -  error.
+	*/
+	bool load(const std::string& path)
+	{
+		cam = camera();
+		materials.clear();
+		spheres.clear();
+		meshes.clear();
+		mesh_paths.clear();
+		instances.clear();
+		objects.clear();
+		error.clear();
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::string data;
+		if (!read_file(path, data)) { return fail(path + ": cannot read file"); }
+		bool ok = (data.compare(0, 4, "RTSB") == 0) ? parse_binary(path, data) : parse_text(path, data);
+		cam.SCENE_FINGERPRINT = fingerprint(data);
+
+		auto stop = std::chrono::steady_clock::now();
+		load_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+		return ok;
+	}
+
+	/*      */
+	bool save_binary(const std::string& path)
+	{
+		if (mesh_paths.size() != meshes.size()) { return fail(path + ": meshes built in code have no file to refer to"); }
+		for (const shared_ptr<geometry_group>& object : objects) {
+			if (object->mesh_paths.size() != object->meshes.size()) { return fail(path + ": meshes built in code have no file to refer to"); }
+		}
+		std::unordered_map<const hittable*, uint32_t> object_index;
+		for (size_t k = 0; k < objects.size(); ++k) { object_index[objects[k].get()] = uint32_t(k); }
+		for (const instance& inst : instances) {
+			if (!object_index.count(inst.get_geometry())) { return fail(path + ": instance refers to geometry outside the scene objects"); }
+		}
+
+		std::ofstream out(path, std::ios::binary);
+		if (!out) { return fail(path + ": cannot write file"); }
+
+		auto write = [&](const void* src, size_t size) { out.write(static_cast<const char*>(src), std::streamsize(size)); };
+		auto write_vec = [&](const vec3& v) {
+			double d[3] = { v.x(), v.y(), v.z() };
+			write(d, sizeof(d));
+		};
+
+		uint32_t version = VERSION;
+		write("RTSB", 4);
+		write(&version, sizeof(version));
+		write(&cam.ASPECT_RATIO, sizeof(double));
+		write(&cam.IMAGE_WIDTH, sizeof(int32_t));
+		write(&cam.SAMPLES_PER_PIXEL, sizeof(int32_t));
+		write(&cam.MAX_DEPTH, sizeof(int32_t));
+		write(&cam.VFOV, sizeof(double));
+		write_vec(cam.LOOKFROM);
+		write_vec(cam.LOOKAT);
+		write_vec(cam.VUP);
+		write(&cam.FOCUS_ANGLE, sizeof(double));
+		write(&cam.FOCUS_DIST, sizeof(double));
+		write(&cam.SKY_BRIGHTNESS, sizeof(double));
+
+		uint32_t count = uint32_t(materials.size());
+		write(&count, sizeof(count));
+		for (uint32_t m = 0; m < count; ++m) {
+			uint32_t type = uint32_t(materials[m].index());
+			double   param[4] = { 0, 0, 0, 0 };
+			if (const lambertian* l = std::get_if<lambertian>(&materials[m])) {
+				param[0] = l->get_albedo().x(); param[1] = l->get_albedo().y(); param[2] = l->get_albedo().z();
+			}
+			else if (const metal* mt = std::get_if<metal>(&materials[m])) {
+				param[0] = mt->get_albedo().x(); param[1] = mt->get_albedo().y(); param[2] = mt->get_albedo().z();
+				param[3] = mt->get_fuzz();
+			}
+			else if (const dielectric* d = std::get_if<dielectric>(&materials[m])) {
+				param[0] = d->get_refraction_index();
+			}
+			else if (const diffuse_light* l = std::get_if<diffuse_light>(&materials[m])) {
+				param[0] = l->get_emit().x(); param[1] = l->get_emit().y(); param[2] = l->get_emit().z();
+			}
+			write(&type, sizeof(type));
+			write(param, sizeof(param));
+		}
+
+		std::filesystem::path base = std::filesystem::absolute(path).parent_path();
+		auto write_primitives = [&](const std::vector<sphere>& in_spheres, const std::vector<triangle_mesh>& in_meshes,
+			const std::vector<std::string>& in_paths) {
+			uint32_t n = uint32_t(in_spheres.size());
+			write(&n, sizeof(n));
+			std::vector<sphere_record> records(in_spheres.size());
+			for (size_t k = 0; k < in_spheres.size(); ++k) {
+				const point3& c = in_spheres[k].get_center();
+				records[k] = { { c.x(), c.y(), c.z() }, in_spheres[k].get_radius(), in_spheres[k].get_material(), 0 };
+			}
+			write(records.data(), records.size() * sizeof(sphere_record));
+
+			n = uint32_t(in_meshes.size());
+			write(&n, sizeof(n));
+			for (size_t k = 0; k < in_meshes.size(); ++k) {
+				std::error_code ec;
+				std::filesystem::path mesh_path = std::filesystem::absolute(in_paths[k]);
+				std::filesystem::path relative = std::filesystem::relative(mesh_path, base, ec);
+				std::string file = (ec || relative.empty() ? mesh_path : relative).generic_string();
+				uint32_t mat = in_meshes[k].get_material(), length = uint32_t(file.size());
+				write(&mat, sizeof(mat));
+				write(&length, sizeof(length));
+				write(file.data(), file.size());
+			}
+		};
+
+		write_primitives(spheres, meshes, mesh_paths);
+		count = uint32_t(objects.size());
+		write(&count, sizeof(count));
+		for (const shared_ptr<geometry_group>& object : objects) { write_primitives(object->spheres, object->meshes, object->mesh_paths); }
+
+		count = uint32_t(instances.size());
+		write(&count, sizeof(count));
+		for (const instance& inst : instances) {
+			instance_record rec = { object_index[inst.get_geometry()], 0, {}, {} };
+			inst.get_transform().to_matrices(rec.forward, rec.inverse);
+			write(&rec, sizeof(rec));
+		}
+
+		if (!out) { return fail(path + ": write error"); }
+		return true;
+	}
+
+	/*
+	 *      bvh_node  .  
+	 *   (   shared_ptr),  
+	 *       .  -    
+	 *   ,  -      
+	 *  (    , . instance.h).
+	*/
+	hittable_list world() const
+	{
+		hittable_list list;
+		list.objects.reserve(spheres.size() + meshes.size() + instances.size());
+		for (const sphere& s : spheres) { list.add(shared_ptr<hittable>(shared_ptr<hittable>(), const_cast<sphere*>(&s))); }
+		for (const triangle_mesh& m : meshes) { list.add(shared_ptr<hittable>(shared_ptr<hittable>(), const_cast<triangle_mesh*>(&m))); }
+		for (const instance& i : instances) { list.add(shared_ptr<hittable>(shared_ptr<hittable>(), const_cast<instance*>(&i))); }
+		return list;
+	}
+
+	/*  ,   :     (  -  ) */
+	size_t triangle_count() const
+	{
+		size_t count = 0;
+		for (const triangle_mesh& m : meshes) { count += m.triangle_count(); }
+		for (const shared_ptr<geometry_group>& object : objects) { count += object->triangle_count(); }
+		return count;
+	}
+
+	/*  ,   :         */
+	size_t instanced_triangle_count() const
+	{
+		size_t count = 0;
+		for (const triangle_mesh& m : meshes) { count += m.triangle_count(); }
+		for (const instance& i : instances) {
+			if (const geometry_group* object = dynamic_cast<const geometry_group*>(i.get_geometry())) { count += object->triangle_count(); }
+		}
+		return count;
+	}
+
+	/*
+	 * ,        ( ).
+	 * random_spheres(11, 2024)   scenes/cover.txt: ,  
+	 *  (2*half_grid)^2       . 
+	 * glass_spheres()  ,  , . single_sphere() - 
+	 *     .  lit_spheres()  ,   
+	 *     . mesh_sphere() -   
+	 *  4*rings^2  (triangle_mesh::uv_sphere())  . 
+	 * instanced_meshes()   (2*half_grid)^2    
+	 *  (       )  
+	 *   .
+	*/
+	static scene random_spheres(int half_grid, uint64_t seed, bool all_glass = false)
+	{
+		scene sc;
+		sc.cam.ASPECT_RATIO = 16.0 / 9.0;
+		sc.cam.VFOV = 20;
+		sc.cam.LOOKFROM = point3(13, 2, 3);
+		sc.cam.LOOKAT = point3(0, 0, 0);
+		sc.cam.FOCUS_ANGLE = 0.6;
+		sc.cam.FOCUS_DIST = 10.0;
+
+		rng gen(seed);
+		sc.spheres.reserve(size_t(4) * half_grid * half_grid + 4);
+		sc.spheres.emplace_back(point3(0, -1000, 0), 1000, sc.materials.add(lambertian(color(0.5, 0.5, 0.5))));
+		for (int a = -half_grid; a < half_grid; ++a) {
+			for (int b = -half_grid; b < half_grid; ++b) {
+				double choose_mat = random_double(gen);
+				double cx = a + 0.9*random_double(gen);
+				double cz = b + 0.9*random_double(gen);
+				point3 center(cx, 0.2, cz);
+				if ((center - point3(4, 0.2, 0)).length() <= 0.9) { continue; }
+
+				uint32_t sphere_mat;
+				if (all_glass) { sphere_mat = sc.materials.add(dielectric(1.5)); }
+				else if (choose_mat < 0.8) {
+					color albedo = color::random(gen);
+					albedo = albedo * color::random(gen);
+					sphere_mat = sc.materials.add(lambertian(albedo));
+				}
+				else if (choose_mat < 0.95) {
+					color albedo = color::random(gen, 0.5, 1);
+					double fuzz = random_double(gen, 0, 0.5);
+					sphere_mat = sc.materials.add(metal(albedo, fuzz));
+				}
+				else { sphere_mat = sc.materials.add(dielectric(1.5)); }
+				sc.spheres.emplace_back(center, 0.2, sphere_mat);
+			}
+		}
+		sc.spheres.emplace_back(point3(0, 1, 0), 1.0, sc.materials.add(dielectric(1.5)));
+		sc.spheres.emplace_back(point3(-4, 1, 0), 1.0, sc.materials.add(all_glass ? material(dielectric(1.5)) : lambertian(color(0.4, 0.2, 0.1))));
+		sc.spheres.emplace_back(point3(4, 1, 0), 1.0, sc.materials.add(all_glass ? material(dielectric(1.5)) : metal(color(0.7, 0.6, 0.5), 0.0)));
+		return sc;
+	}
+
+	static scene glass_spheres(int half_grid, uint64_t seed) { return random_spheres(half_grid, seed, true); }
+
+	static scene lit_spheres(int half_grid, uint64_t seed)
+	{
+		scene sc = random_spheres(half_grid, seed);
+		sc.cam.SKY_BRIGHTNESS = 0.02;
+		uint32_t warm = sc.materials.add(diffuse_light(color(60, 45, 30)));
+		uint32_t cold = sc.materials.add(diffuse_light(color(20, 30, 60)));
+		sc.spheres.emplace_back(point3(-2, 3, 2), 0.15, warm);
+		sc.spheres.emplace_back(point3(2, 2.5, -2), 0.15, cold);
+		sc.spheres.emplace_back(point3(6, 1.5, 1), 0.1, warm);
+		return sc;
+	}
+
+	static scene mesh_sphere(int rings)
+	{
+		scene sc;
+		sc.cam.ASPECT_RATIO = 16.0 / 9.0;
+		sc.cam.VFOV = 20;
+		sc.cam.LOOKFROM = point3(13, 2, 3);
+		sc.cam.LOOKAT = point3(0, 0.5, 0);
+		sc.spheres.emplace_back(point3(0, -1000, 0), 1000, sc.materials.add(lambertian(color(0.5, 0.5, 0.5))));
+		sc.meshes.push_back(triangle_mesh::uv_sphere(point3(0, 1, 0), 1, rings, 2 * rings, sc.materials.add(lambertian(color(0.4, 0.2, 0.1)))));
+		return sc;
+	}
+
+	static scene instanced_meshes(int half_grid, int rings, uint64_t seed)
+	{
+		scene sc;
+		sc.cam.ASPECT_RATIO = 16.0 / 9.0;
+		sc.cam.VFOV = 20;
+		sc.cam.LOOKFROM = point3(13, 2, 3);
+		sc.cam.LOOKAT = point3(0, 0, 0);
+		sc.spheres.emplace_back(point3(0, -1000, 0), 1000, sc.materials.add(lambertian(color(0.5, 0.5, 0.5))));
+
+		auto object = make_shared<geometry_group>();
+		object->meshes.push_back(triangle_mesh::uv_sphere(point3(0, 1, 0), 1, rings, 2 * rings, sc.materials.add(lambertian(color(0.4, 0.2, 0.1)))));
+		object->spheres.emplace_back(point3(0.6, 2.1, 0), 0.3, sc.materials.add(metal(color(0.7, 0.6, 0.5), 0.1)));
+		object->build();
+		sc.objects.push_back(object);
+
+		rng gen(seed);
+		sc.instances.reserve(size_t(4) * half_grid * half_grid);
+		for (int a = -half_grid; a < half_grid; ++a) {
+			for (int b = -half_grid; b < half_grid; ++b) {
+				double size = random_double(gen, 0.1, 0.2);
+				point3 position(a + 0.5 + 0.4*random_double(gen, -1, 1), 0, b + 0.5 + 0.4*random_double(gen, -1, 1));
+				transform to_world = transform::translate(position) * transform::rotate(vec3(0, 1, 0), random_double(gen, 0, 360))
+					* transform::scale(vec3(size, size, size));
+				sc.instances.emplace_back(object, to_world);
+			}
+		}
+		return sc;
+	}
+
+	static scene single_sphere()
+	{
+		scene sc;
+		sc.cam.ASPECT_RATIO = 16.0 / 9.0;
+		sc.cam.VFOV = 90;
+		sc.spheres.emplace_back(point3(0, 0, -1), 0.5, sc.materials.add(lambertian(color(0.1, 0.2, 0.5))));
+		return sc;
+	}
+};
+
+#endif
@@ -0,0 +1,102 @@
+/***********************************************************************************
+*   scheduler.h      
+* (work stealing),      .
+*
+*       .   
+*   .       ,    
+*  -       .  
+* ""  (,       )
+*      .
+*
+*     1       
+* ,    .
+***********************************************************************************/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*      */
+template <typename T>
+class work_queue
+{
+private:
+	std::deque<T> tasks;
+	std::mutex    lock;
+public:
+	void push(const T& task)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		tasks.push_back(task);
+	}
+
+	//      .
+	bool pop(T& task)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (tasks.empty()) { return false; }
+		task = tasks.back();
+		tasks.pop_back();
+		return true;
+	}
+
+	//       .
+	bool steal(T& task)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (tasks.empty()) { return false; }
+		task = tasks.front();
+		tasks.pop_front();
+		return true;
+	}
+};
+
+/*   :   <= 0     */
+inline int resolve_thread_count(int threads)
+{
+	if (threads > 0) { return threads; }
+	unsigned int hw = std::thread::hardware_concurrency();
+	return hw > 0 ? int(hw) : 1;
+}
+
+/*
+ *  run_work_stealing()  fn(task, worker)     tasks
+ *  threads .       ,  
+ *  ,        ,    .
+*/
+template <typename T, typename F>
+void run_work_stealing(const std::vector<T>& tasks, int threads, F&& fn)
+{
+	threads = resolve_thread_count(threads);
+	if (threads > int(tasks.size())) { threads = int(tasks.size()); }
+
+	if (threads <= 1) {
+		for (const T& task : tasks) { fn(task, 0); }
+		return;
+	}
+
+	std::vector<work_queue<T>> queues(threads);
+	//     ,         .
+	for (int i = int(tasks.size()) - 1; i >= 0; --i) { queues[i % threads].push(tasks[i]); }
+
+	auto worker = [&](int id) {
+		T task;
+		for (;;) {
+			bool found = queues[id].pop(task);
+			for (int k = 1; !found && k < threads; ++k) { found = queues[(id + k) % threads].steal(task); }
+			if (!found) { return; }
+			fn(task, id);
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (int id = 1; id < threads; ++id) { pool.emplace_back(worker, id); }
+	worker(0); //      
+	for (std::thread& t : pool) { t.join(); }
+}
+
+#endif
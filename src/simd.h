@@ -0,0 +1,106 @@
+/***********************************************************************************
+*   simd.h      (SIMD) :
+*         ,
+*     .
+*
+*          
+* target (GCC/Clang)    ,      
+*  AVX-512  AVX2 ,   ,     
+* .  RT_SIMD_X86 ,    .
+***********************************************************************************/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/*
+ * GCC      FMA (-ffp-contract=fast),  
+ *    (avx512f),    ,   ;
+ * optimize("fp-contract=off")     .
+*/
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__clang__)
+	#define RT_SIMD_X86 1
+	#define RT_TARGET_AVX2   __attribute__((target("avx2")))
+	#define RT_TARGET_AVX512 __attribute__((target("avx512f")))
+	#include <immintrin.h>
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+	#define RT_SIMD_X86 1
+	#define RT_TARGET_AVX2   __attribute__((target("avx2"), optimize("fp-contract=off")))
+	#define RT_TARGET_AVX512 __attribute__((target("avx512f"), optimize("fp-contract=off")))
+	#include <immintrin.h>
+#elif defined(_M_X64) && defined(_MSC_VER)
+	#define RT_SIMD_X86 1
+	#define RT_TARGET_AVX2
+	#define RT_TARGET_AVX512
+	#include <immintrin.h>
+	#include <intrin.h>
+#endif
+
+/*  ,    */
+enum class simd_level { scalar = 0, avx2 = 1, avx512 = 2 };
+
+inline const char* simd_level_name(simd_level level)
+{
+	switch (level) {
+	case simd_level::avx512: return "avx512";
+	case simd_level::avx2:   return "avx2";
+	default:                 return "scalar";
+	}
+}
+
+/*    ,     */
+inline simd_level detect_simd_level()
+{
+#if defined(RT_SIMD_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!osxsave) { return simd_level::scalar; }
+	unsigned long long xcr0 = _xgetbv(0);
+	__cpuidex(info, 7, 0);
+	bool avx2   = (info[1] & (1 << 5))  != 0 && (xcr0 & 0x6) == 0x6;
+	bool avx512 = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+	if (avx512) { return simd_level::avx512; }
+	if (avx2)   { return simd_level::avx2; }
+	return simd_level::scalar;
+#elif defined(RT_SIMD_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) { return simd_level::avx512; }
+	if (__builtin_cpu_supports("avx2")) { return simd_level::avx2; }
+	return simd_level::scalar;
+#else
+	return simd_level::scalar;
+#endif
+}
+
+/*
+ *   std::vector,     Align , 
+ *        .
+*/
+template <typename T, std::size_t Align = 64>
+class aligned_allocator
+{
+public:
+	using value_type = T;
+
+	template <typename U> struct rebind { using other = aligned_allocator<U, Align>; };
+
+	aligned_allocator() noexcept {}
+	template <typename U> aligned_allocator(const aligned_allocator<U, Align>&) noexcept {}
+
+	T* allocate(std::size_t n)
+	{
+		void* p = ::operator new(n * sizeof(T), std::align_val_t(Align));
+		return static_cast<T*>(p);
+	}
+
+	void deallocate(T* p, std::size_t) noexcept { ::operator delete(p, std::align_val_t(Align)); }
+
+	template <typename U> bool operator==(const aligned_allocator<U, Align>&) const noexcept { return true; }
+	template <typename U> bool operator!=(const aligned_allocator<U, Align>&) const noexcept { return false; }
+};
+
+#endif
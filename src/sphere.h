@@ -6,11 +6,20 @@
 class sphere : public hittable {
 private:
 	point3 center;
-	double radius;
-	shared_ptr<material> mat;
+	real   radius;
+	uint32_t mat;	//    
+	aabb bbox;
 public:
-	sphere(const point3& center, double radius, shared_ptr<material> mat) 
-		: center(center), radius(std::fmax(0, radius)), mat(mat) {}
+	sphere(const point3& center, real radius, uint32_t mat) 
+		: center(center), radius(std::fmax(real(0), radius)), mat(mat) 
+	{
+		vec3 rvec = vec3(this->radius, this->radius, this->radius);
+		bbox = aabb(center - rvec, center + rvec);
+	}
+
+	const point3&        get_center()   const { return center; }
+	real                 get_radius()   const { return radius; }
+	uint32_t             get_material() const { return mat; }
 
 	/* hit()   x^2 + y^2 + z^2 = r^2    
 	 *    .  x^2 + y^2 + z^2 = r^2
@@ -61,32 +70,71 @@ public:
 	*/
 	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
 	{
+		RT_COUNT(primitive_tests, 1);
 		vec3 oc = center - r.origin();
-		double a = r.direction().length_squared();
-		double h = dot(r.direction(), oc);
-		double c = oc.length_squared() - radius*radius;
+		real a = r.direction().length_squared();
+		real h = dot(r.direction(), oc);
+		real c = oc.length_squared() - radius*radius;
 
-		double discriminant = h*h - a*c;
+		real discriminant = h*h - a*c;
 		if (discriminant < 0) { return false; }
 		
-		double sqrtd = std::sqrt(discriminant);
+		real sqrtd = std::sqrt(discriminant);
 
 		//      
-		double root = (h - sqrtd) / a;
+		real root = (h - sqrtd) / a;
 		if (!ray_t.surrounds(root)) { 
 			root = (h + sqrtd) / a;
 			if (!ray_t.surrounds(root)) { return false; }
 		}
 
-		rec.p = r.at(root);
-		vec3 outward_normal = (rec.p - center) / radius; //     , ..    
-														 //	   .    
-														 //   ,     set_face_normal().
+		fill_record(r, root, center, radius, mat, rec);
+		return true;
+	}
+
+	/*     ray_t - ;      */
+	bool occluded(const ray& r, interval ray_t) const override
+	{
+		RT_COUNT(primitive_tests, 1);
+		vec3 oc = center - r.origin();
+		real a = r.direction().length_squared();
+		real h = dot(r.direction(), oc);
+		real c = oc.length_squared() - radius*radius;
+
+		real discriminant = h*h - a*c;
+		if (discriminant < 0) { return false; }
+
+		real sqrtd = std::sqrt(discriminant);
+		return ray_t.surrounds((h - sqrtd) / a) || ray_t.surrounds((h + sqrtd) / a);
+	}
+
+	/*
+	 *  rec    r   (center, radius)  t = root.
+	 *
+	 *        ( 
+	 * h*h  a*c, |oc|^2  r^2),   r.at(root)    
+	 *    eps * |oc|^2 / r,     -  .
+	 *      ,     
+	 *    : rec.error (. spawn_ray()).
+	 *    sphere_soa,   .
+	*/
+	static void fill_record(const ray& r, real root, const point3& center, real radius, uint32_t mat, hit_record& rec)
+	{
+		vec3 radial = r.at(root) - center;
+		radial *= radius / radial.length();
+		rec.p = center + radial;
+		vec3 outward_normal = radial / radius; //     , ..    
+											   //	   .    
+											   //   ,     set_face_normal().
 		rec.set_face_normal(r, outward_normal);
 		rec.t = root;
-		rec.mat = mat;
-		
-		return true;
+		rec.mat_id = mat;
+		rec.u = rec.v = 0;
+
+		real extent = std::fmax(std::fabs(center.x()), std::fmax(std::fabs(center.y()), std::fabs(center.z()))) + radius;
+		rec.error = rounding_bound(8) * extent;
 	}
+
+	aabb bounding_box() const override { return bbox; }
 };
 #endif
\ No newline at end of file
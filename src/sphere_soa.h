@@ -0,0 +1,438 @@
+/***********************************************************************************
+*   sphere_soa.h   ,   
+*  (structure of arrays):  ,  , 
+*    ( material_table)     
+*  .
+*
+*   sphere.h -    ,   shared_ptr 
+*   hit(),        
+*  ,    .  sphere_soa     
+* (. sphere::hit())    4 (AVX2)  8 (AVX-512) : 
+*     ,       .
+*          , 
+*      hit_record.
+*
+*       (. simd.h),   
+* AVX2        .  
+*   8   ""     -INF, 
+*    .
+*
+* occluded() ( , . hittable::occluded())     
+*   :       ,
+*           .
+*
+*  hit_range()     [first, first+count), 
+*       (leaf_objects  flat_bvh.h):
+*    ,     .
+***********************************************************************************/
+
+#ifndef SPHERE_SOA_H
+#define SPHERE_SOA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "hittable.h"
+#include "sphere.h"
+#include "simd.h"
+
+class sphere_soa : public hittable
+{
+public:
+	static const size_t LANES = 8; //    
+
+	sphere_soa() : level(detect_simd_level()) {}
+
+	void add(const point3& center, real radius, uint32_t mat_index)
+	{
+		radius = std::fmax(0, radius);
+
+		if (count == cx.size()) { grow(); }
+		cx[count] = center.x();
+		cy[count] = center.y();
+		cz[count] = center.z();
+		r2[count] = radius * radius;
+		radii[count] = radius;
+		mat_id[count] = mat_index;
+		++count;
+
+		vec3 rvec(radius, radius, radius);
+		bbox = aabb(bbox, aabb(center - rvec, center + rvec));
+	}
+
+	void add(const sphere& s) { add(s.get_center(), s.get_radius(), s.get_material()); }
+
+	/*   (  -INF):  ,     */
+	void add_empty()
+	{
+		if (count == cx.size()) { grow(); }
+		++count;
+	}
+
+	void clear()
+	{
+		std::fill(r2.begin(), r2.end(), -INF);
+		count = 0;
+		bbox  = aabb();
+	}
+
+	size_t size() const { return count; }
+	size_t memory_bytes() const { return cx.capacity() * 5 * sizeof(double) + mat_id.capacity() * sizeof(uint32_t); }
+
+	point3 center(size_t k) const { return point3(cx[k], cy[k], cz[k]); }
+	real   radius(size_t k) const { return real(radii[k]); }
+	aabb   bounding_box(size_t k) const
+	{
+		vec3 rvec(radius(k), radius(k), radius(k));
+		return aabb(center(k) - rvec, center(k) + rvec);
+	}
+
+	simd_level get_simd_level() const { return level; }
+	void       set_simd_level(simd_level l) { level = (l <= detect_simd_level()) ? l : detect_simd_level(); }
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		return hit_range(r, ray_t, rec, 0, count);
+	}
+
+	/*      [first, first+n)    rec  */
+	bool hit_range(const ray& r, interval ray_t, hit_record& rec, size_t first, size_t n) const
+	{
+		RT_COUNT(primitive_tests, (long long)n);
+		double t;
+		size_t k;
+		bool found;
+		switch (level) {
+#ifdef RT_SIMD_X86
+		case simd_level::avx512: found = closest_avx512(r, ray_t, first, n, t, k); break;
+		case simd_level::avx2:   found = closest_avx2(r, ray_t, first, n, t, k);   break;
+#endif
+		default:                 found = closest_scalar(r, ray_t, first, n, t, k); break;
+		}
+		if (!found) { return false; }
+
+		sphere::fill_record(r, real(t), center(k), real(radius(k)), mat_id[k], rec);
+		return true;
+	}
+
+	bool occluded(const ray& r, interval ray_t) const override
+	{
+		return occluded_range(r, ray_t, 0, count);
+	}
+
+	/* true,       [first, first+n)    ray_t */
+	bool occluded_range(const ray& r, interval ray_t, size_t first, size_t n) const
+	{
+		RT_COUNT(primitive_tests, (long long)n);
+		switch (level) {
+#ifdef RT_SIMD_X86
+		case simd_level::avx512: return any_avx512(r, ray_t, first, n);
+		case simd_level::avx2:   return any_avx2(r, ray_t, first, n);
+#endif
+		default:                 return any_scalar(r, ray_t, first, n);
+		}
+	}
+
+	aabb bounding_box() const override { return bbox; }
+
+private:
+	template <typename T> using aligned_vector = std::vector<T, aligned_allocator<T, 64>>;
+
+	aligned_vector<double>   cx, cy, cz;	//  
+	aligned_vector<double>   r2;			//   (-INF   )
+	aligned_vector<double>   radii;		//   hit_record (sqrt(r2)    )
+	aligned_vector<uint32_t> mat_id;		//     
+	size_t count = 0;
+
+	aabb       bbox;
+	simd_level level;
+
+	void grow()
+	{
+		size_t cap = cx.empty() ? LANES : cx.size() * 2;
+		cx.resize(cap, 0.0);
+		cy.resize(cap, 0.0);
+		cz.resize(cap, 0.0);
+		r2.resize(cap, -INF);
+		radii.resize(cap, 0.0);
+		mat_id.resize(cap, 0);
+	}
+
+	/*
+	 *  :    ,    sphere::hit(), 
+	 *      .
+	*/
+	bool closest_scalar(const ray& r, interval ray_t, size_t first, size_t n, double& t_out, size_t& k_out) const
+	{
+		const point3& o = r.origin();
+		const vec3&   d = r.direction();
+		double a = d.length_squared();
+		bool found = false;
+
+		for (size_t k = first; k < first + n; ++k) {
+			double ocx = cx[k] - o.x(), ocy = cy[k] - o.y(), ocz = cz[k] - o.z();
+			double h = d.x()*ocx + d.y()*ocy + d.z()*ocz;
+			double c = (ocx*ocx + ocy*ocy + ocz*ocz) - r2[k];
+			double discriminant = h*h - a*c;
+			if (discriminant < 0) { continue; }
+
+			double sqrtd = std::sqrt(discriminant);
+			double root = (h - sqrtd) / a;
+			if (!ray_t.surrounds(root)) {
+				root = (h + sqrtd) / a;
+				if (!ray_t.surrounds(root)) { continue; }
+			}
+			ray_t.max = root;
+			t_out = root;
+			k_out = k;
+			found = true;
+		}
+		return found;
+	}
+
+	bool any_scalar(const ray& r, interval ray_t, size_t first, size_t n) const
+	{
+		const point3& o = r.origin();
+		const vec3&   d = r.direction();
+		double a = d.length_squared();
+
+		for (size_t k = first; k < first + n; ++k) {
+			double ocx = cx[k] - o.x(), ocy = cy[k] - o.y(), ocz = cz[k] - o.z();
+			double h = d.x()*ocx + d.y()*ocy + d.z()*ocz;
+			double c = (ocx*ocx + ocy*ocy + ocz*ocz) - r2[k];
+			double discriminant = h*h - a*c;
+			if (discriminant < 0) { continue; }
+
+			double sqrtd = std::sqrt(discriminant);
+			if (ray_t.surrounds((h - sqrtd) / a) || ray_t.surrounds((h + sqrtd) / a)) { return true; }
+		}
+		return false;
+	}
+
+#ifdef RT_SIMD_X86
+	RT_TARGET_AVX2
+	bool any_avx2(const ray& r, interval ray_t, size_t first, size_t n) const
+	{
+		const point3& o = r.origin();
+		const vec3&   d = r.direction();
+
+		const __m256d ox = _mm256_set1_pd(o.x()), oy = _mm256_set1_pd(o.y()), oz = _mm256_set1_pd(o.z());
+		const __m256d dx = _mm256_set1_pd(d.x()), dy = _mm256_set1_pd(d.y()), dz = _mm256_set1_pd(d.z());
+		const __m256d a    = _mm256_set1_pd(d.length_squared());
+		const __m256d tmin = _mm256_set1_pd(ray_t.min);
+		const __m256d tmax = _mm256_set1_pd(ray_t.max);
+		const __m256d zero = _mm256_setzero_pd();
+
+		size_t begin = first & ~size_t(3);
+		size_t end   = first + n;
+		__m256d lane_k = _mm256_add_pd(_mm256_set_pd(3.0, 2.0, 1.0, 0.0), _mm256_set1_pd(double(begin)));
+		const __m256d step = _mm256_set1_pd(4.0);
+		const __m256d kmin = _mm256_set1_pd(double(first));
+		const __m256d kmax = _mm256_set1_pd(double(end));
+
+		for (size_t k = begin; k < end; k += 4) {
+			__m256d ocx = _mm256_sub_pd(_mm256_load_pd(&cx[k]), ox);
+			__m256d ocy = _mm256_sub_pd(_mm256_load_pd(&cy[k]), oy);
+			__m256d ocz = _mm256_sub_pd(_mm256_load_pd(&cz[k]), oz);
+
+			__m256d h = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, ocx), _mm256_mul_pd(dy, ocy)), _mm256_mul_pd(dz, ocz));
+			__m256d oc2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, ocx), _mm256_mul_pd(ocy, ocy)), _mm256_mul_pd(ocz, ocz));
+			__m256d c = _mm256_sub_pd(oc2, _mm256_load_pd(&r2[k]));
+			__m256d disc = _mm256_sub_pd(_mm256_mul_pd(h, h), _mm256_mul_pd(a, c));
+
+			__m256d valid = _mm256_and_pd(_mm256_cmp_pd(disc, zero, _CMP_GE_OQ),
+				_mm256_and_pd(_mm256_cmp_pd(lane_k, kmin, _CMP_GE_OQ), _mm256_cmp_pd(lane_k, kmax, _CMP_LT_OQ)));
+			if (_mm256_movemask_pd(valid) != 0) {
+				__m256d sqrtd = _mm256_sqrt_pd(_mm256_max_pd(disc, zero));
+				__m256d root1 = _mm256_div_pd(_mm256_sub_pd(h, sqrtd), a);
+				__m256d root2 = _mm256_div_pd(_mm256_add_pd(h, sqrtd), a);
+
+				__m256d ok1 = _mm256_and_pd(_mm256_cmp_pd(root1, tmin, _CMP_GT_OQ), _mm256_cmp_pd(root1, tmax, _CMP_LT_OQ));
+				__m256d ok2 = _mm256_and_pd(_mm256_cmp_pd(root2, tmin, _CMP_GT_OQ), _mm256_cmp_pd(root2, tmax, _CMP_LT_OQ));
+				if (_mm256_movemask_pd(_mm256_and_pd(valid, _mm256_or_pd(ok1, ok2))) != 0) { return true; }
+			}
+			lane_k = _mm256_add_pd(lane_k, step);
+		}
+		return false;
+	}
+
+	RT_TARGET_AVX512
+	bool any_avx512(const ray& r, interval ray_t, size_t first, size_t n) const
+	{
+		const point3& o = r.origin();
+		const vec3&   d = r.direction();
+
+		const __m512d ox = _mm512_set1_pd(o.x()), oy = _mm512_set1_pd(o.y()), oz = _mm512_set1_pd(o.z());
+		const __m512d dx = _mm512_set1_pd(d.x()), dy = _mm512_set1_pd(d.y()), dz = _mm512_set1_pd(d.z());
+		const __m512d a    = _mm512_set1_pd(d.length_squared());
+		const __m512d tmin = _mm512_set1_pd(ray_t.min);
+		const __m512d tmax = _mm512_set1_pd(ray_t.max);
+		const __m512d zero = _mm512_setzero_pd();
+
+		size_t begin = first & ~size_t(7);
+		size_t end   = first + n;
+		__m512d lane_k = _mm512_add_pd(_mm512_set_pd(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0), _mm512_set1_pd(double(begin)));
+		const __m512d step = _mm512_set1_pd(8.0);
+		const __m512d kmin = _mm512_set1_pd(double(first));
+		const __m512d kmax = _mm512_set1_pd(double(end));
+
+		for (size_t k = begin; k < end; k += 8) {
+			__m512d ocx = _mm512_sub_pd(_mm512_load_pd(&cx[k]), ox);
+			__m512d ocy = _mm512_sub_pd(_mm512_load_pd(&cy[k]), oy);
+			__m512d ocz = _mm512_sub_pd(_mm512_load_pd(&cz[k]), oz);
+
+			__m512d h = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, ocx), _mm512_mul_pd(dy, ocy)), _mm512_mul_pd(dz, ocz));
+			__m512d oc2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(ocx, ocx), _mm512_mul_pd(ocy, ocy)), _mm512_mul_pd(ocz, ocz));
+			__m512d c = _mm512_sub_pd(oc2, _mm512_load_pd(&r2[k]));
+			__m512d disc = _mm512_sub_pd(_mm512_mul_pd(h, h), _mm512_mul_pd(a, c));
+
+			__mmask8 valid = _mm512_cmp_pd_mask(disc, zero, _CMP_GE_OQ)
+				& _mm512_cmp_pd_mask(lane_k, kmin, _CMP_GE_OQ) & _mm512_cmp_pd_mask(lane_k, kmax, _CMP_LT_OQ);
+			if (valid != 0) {
+				__m512d sqrtd = _mm512_maskz_sqrt_pd(valid, disc);
+				__m512d root1 = _mm512_div_pd(_mm512_sub_pd(h, sqrtd), a);
+				__m512d root2 = _mm512_div_pd(_mm512_add_pd(h, sqrtd), a);
+
+				__mmask8 ok1 = _mm512_cmp_pd_mask(root1, tmin, _CMP_GT_OQ) & _mm512_cmp_pd_mask(root1, tmax, _CMP_LT_OQ);
+				__mmask8 ok2 = _mm512_cmp_pd_mask(root2, tmin, _CMP_GT_OQ) & _mm512_cmp_pd_mask(root2, tmax, _CMP_LT_OQ);
+				if ((valid & (ok1 | ok2)) != 0) { return true; }
+			}
+			lane_k = _mm512_add_pd(lane_k, step);
+		}
+		return false;
+	}
+
+	RT_TARGET_AVX2
+	bool closest_avx2(const ray& r, interval ray_t, size_t first, size_t n, double& t_out, size_t& k_out) const
+	{
+		const point3& o = r.origin();
+		const vec3&   d = r.direction();
+
+		const __m256d ox = _mm256_set1_pd(o.x()), oy = _mm256_set1_pd(o.y()), oz = _mm256_set1_pd(o.z());
+		const __m256d dx = _mm256_set1_pd(d.x()), dy = _mm256_set1_pd(d.y()), dz = _mm256_set1_pd(d.z());
+		const __m256d a    = _mm256_set1_pd(d.length_squared());
+		const __m256d tmin = _mm256_set1_pd(ray_t.min);
+		const __m256d zero = _mm256_setzero_pd();
+
+		__m256d best_t = _mm256_set1_pd(ray_t.max);
+		__m256d best_k = _mm256_set1_pd(-1.0);
+		__m256d lane_k = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+		const __m256d step = _mm256_set1_pd(4.0);
+
+		//      4,      .
+		size_t begin = first & ~size_t(3);
+		size_t end   = first + n;
+		lane_k = _mm256_add_pd(lane_k, _mm256_set1_pd(double(begin)));
+		const __m256d kmin = _mm256_set1_pd(double(first));
+		const __m256d kmax = _mm256_set1_pd(double(end));
+
+		for (size_t k = begin; k < end; k += 4) {
+			__m256d ocx = _mm256_sub_pd(_mm256_load_pd(&cx[k]), ox);
+			__m256d ocy = _mm256_sub_pd(_mm256_load_pd(&cy[k]), oy);
+			__m256d ocz = _mm256_sub_pd(_mm256_load_pd(&cz[k]), oz);
+
+			__m256d h = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, ocx), _mm256_mul_pd(dy, ocy)), _mm256_mul_pd(dz, ocz));
+			__m256d oc2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, ocx), _mm256_mul_pd(ocy, ocy)), _mm256_mul_pd(ocz, ocz));
+			__m256d c = _mm256_sub_pd(oc2, _mm256_load_pd(&r2[k]));
+			__m256d disc = _mm256_sub_pd(_mm256_mul_pd(h, h), _mm256_mul_pd(a, c));
+
+			__m256d valid = _mm256_and_pd(_mm256_cmp_pd(disc, zero, _CMP_GE_OQ),
+				_mm256_and_pd(_mm256_cmp_pd(lane_k, kmin, _CMP_GE_OQ), _mm256_cmp_pd(lane_k, kmax, _CMP_LT_OQ)));
+			if (_mm256_movemask_pd(valid) != 0) {
+				__m256d sqrtd = _mm256_sqrt_pd(_mm256_max_pd(disc, zero));
+				__m256d root1 = _mm256_div_pd(_mm256_sub_pd(h, sqrtd), a);
+				__m256d root2 = _mm256_div_pd(_mm256_add_pd(h, sqrtd), a);
+
+				__m256d ok1 = _mm256_and_pd(_mm256_cmp_pd(root1, tmin, _CMP_GT_OQ), _mm256_cmp_pd(root1, best_t, _CMP_LT_OQ));
+				__m256d ok2 = _mm256_and_pd(_mm256_cmp_pd(root2, tmin, _CMP_GT_OQ), _mm256_cmp_pd(root2, best_t, _CMP_LT_OQ));
+				__m256d root = _mm256_blendv_pd(root2, root1, ok1);
+				__m256d upd  = _mm256_and_pd(valid, _mm256_or_pd(ok1, ok2));
+
+				best_t = _mm256_blendv_pd(best_t, root, upd);
+				best_k = _mm256_blendv_pd(best_k, lane_k, upd);
+			}
+			lane_k = _mm256_add_pd(lane_k, step);
+		}
+
+		alignas(32) double t[4], idx[4];
+		_mm256_store_pd(t, best_t);
+		_mm256_store_pd(idx, best_k);
+		return reduce_lanes(t, idx, 4, t_out, k_out);
+	}
+
+	RT_TARGET_AVX512
+	bool closest_avx512(const ray& r, interval ray_t, size_t first, size_t n, double& t_out, size_t& k_out) const
+	{
+		const point3& o = r.origin();
+		const vec3&   d = r.direction();
+
+		const __m512d ox = _mm512_set1_pd(o.x()), oy = _mm512_set1_pd(o.y()), oz = _mm512_set1_pd(o.z());
+		const __m512d dx = _mm512_set1_pd(d.x()), dy = _mm512_set1_pd(d.y()), dz = _mm512_set1_pd(d.z());
+		const __m512d a    = _mm512_set1_pd(d.length_squared());
+		const __m512d tmin = _mm512_set1_pd(ray_t.min);
+		const __m512d zero = _mm512_setzero_pd();
+
+		__m512d best_t = _mm512_set1_pd(ray_t.max);
+		__m512d best_k = _mm512_set1_pd(-1.0);
+		__m512d lane_k = _mm512_set_pd(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0);
+		const __m512d step = _mm512_set1_pd(8.0);
+
+		size_t begin = first & ~size_t(7);
+		size_t end   = first + n;
+		lane_k = _mm512_add_pd(lane_k, _mm512_set1_pd(double(begin)));
+		const __m512d kmin = _mm512_set1_pd(double(first));
+		const __m512d kmax = _mm512_set1_pd(double(end));
+
+		for (size_t k = begin; k < end; k += 8) {
+			__m512d ocx = _mm512_sub_pd(_mm512_load_pd(&cx[k]), ox);
+			__m512d ocy = _mm512_sub_pd(_mm512_load_pd(&cy[k]), oy);
+			__m512d ocz = _mm512_sub_pd(_mm512_load_pd(&cz[k]), oz);
+
+			__m512d h = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, ocx), _mm512_mul_pd(dy, ocy)), _mm512_mul_pd(dz, ocz));
+			__m512d oc2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(ocx, ocx), _mm512_mul_pd(ocy, ocy)), _mm512_mul_pd(ocz, ocz));
+			__m512d c = _mm512_sub_pd(oc2, _mm512_load_pd(&r2[k]));
+			__m512d disc = _mm512_sub_pd(_mm512_mul_pd(h, h), _mm512_mul_pd(a, c));
+
+			__mmask8 valid = _mm512_cmp_pd_mask(disc, zero, _CMP_GE_OQ)
+				& _mm512_cmp_pd_mask(lane_k, kmin, _CMP_GE_OQ) & _mm512_cmp_pd_mask(lane_k, kmax, _CMP_LT_OQ);
+			if (valid != 0) {
+				__m512d sqrtd = _mm512_maskz_sqrt_pd(valid, disc);
+				__m512d root1 = _mm512_div_pd(_mm512_sub_pd(h, sqrtd), a);
+				__m512d root2 = _mm512_div_pd(_mm512_add_pd(h, sqrtd), a);
+
+				__mmask8 ok1 = _mm512_cmp_pd_mask(root1, tmin, _CMP_GT_OQ) & _mm512_cmp_pd_mask(root1, best_t, _CMP_LT_OQ);
+				__mmask8 ok2 = _mm512_cmp_pd_mask(root2, tmin, _CMP_GT_OQ) & _mm512_cmp_pd_mask(root2, best_t, _CMP_LT_OQ);
+				__m512d  root = _mm512_mask_blend_pd(ok1, root2, root1);
+				__mmask8 upd  = valid & (ok1 | ok2);
+
+				best_t = _mm512_mask_blend_pd(upd, best_t, root);
+				best_k = _mm512_mask_blend_pd(upd, best_k, lane_k);
+			}
+			lane_k = _mm512_add_pd(lane_k, step);
+		}
+
+		alignas(64) double t[8], idx[8];
+		_mm512_store_pd(t, best_t);
+		_mm512_store_pd(idx, best_k);
+		return reduce_lanes(t, idx, 8, t_out, k_out);
+	}
+#endif
+
+	//      .
+	static bool reduce_lanes(const double* t, const double* idx, int lanes, double& t_out, size_t& k_out)
+	{
+		bool found = false;
+		for (int l = 0; l < lanes; ++l) {
+			if (idx[l] < 0) { continue; }
+			if (!found || t[l] < t_out || (t[l] == t_out && size_t(idx[l]) < k_out)) {
+				t_out = t[l];
+				k_out = size_t(idx[l]);
+				found = true;
+			}
+		}
+		return found;
+	}
+};
+
+#endif
@@ -0,0 +1,229 @@
+/***********************************************************************************
+*   transform.h    transform:
+* p' = M*p + t,  M -  3x3 (, , ), t - .
+*
+*      ( -> ),   ( ->
+* ):  (instance.h)      
+*   ,    -    .
+*     :  
+*  M*n   .
+*
+*   (translate, scale, rotate)    
+*  ,  a*b ( b,  a)  
+*      ,     
+* (from_matrix())    ,     .
+***********************************************************************************/
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <cmath>
+#include <utility>
+
+#include "hittable.h"
+
+class transform
+{
+private:
+	real m[3][4];	//  -> :  0..2 - M,  3 - t
+	real inv[3][4];	//  -> 
+
+	static void multiply(const real a[3][4], const real b[3][4], real out[3][4])
+	{
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 4; ++j) {
+				real sum = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j];
+				out[i][j] = (j == 3) ? sum + a[i][3] : sum;
+			}
+		}
+	}
+
+	static void identity(real a[3][4])
+	{
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 4; ++j) { a[i][j] = (i == j) ? real(1) : real(0); }
+		}
+	}
+
+public:
+	transform() { identity(m); identity(inv); }
+
+	static transform translate(const vec3& d)
+	{
+		transform t;
+		for (int i = 0; i < 3; ++i) { t.m[i][3] = d[i]; t.inv[i][3] = -d[i]; }
+		return t;
+	}
+
+	/*   ;      */
+	static transform scale(const vec3& s)
+	{
+		transform t;
+		for (int i = 0; i < 3; ++i) { t.m[i][i] = s[i]; t.inv[i][i] = 1 / s[i]; }
+		return t;
+	}
+
+	/*   degrees    axis ( );  -  */
+	static transform rotate(const vec3& axis, double degrees)
+	{
+		vec3   a = unitv(axis);
+		double theta = degrees_to_radians(degrees);
+		double s = std::sin(theta), c = std::cos(theta);
+		double x = a.x(), y = a.y(), z = a.z();
+		double r[3][3] = {
+			{ c + x*x*(1 - c),   x*y*(1 - c) - z*s, x*z*(1 - c) + y*s },
+			{ y*x*(1 - c) + z*s, c + y*y*(1 - c),   y*z*(1 - c) - x*s },
+			{ z*x*(1 - c) - y*s, z*y*(1 - c) + x*s, c + z*z*(1 - c)   } };
+		transform t;
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) { t.m[i][j] = real(r[i][j]); t.inv[j][i] = real(r[i][j]); }
+		}
+		return t;
+	}
+
+	/*
+	 *    values (3   4 : M  t). 
+	 *      double; false -  .
+	*/
+	static bool from_matrix(const double values[12], transform& t)
+	{
+		double a[3][3], b[3];
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) { a[i][j] = values[4*i + j]; }
+			b[i] = values[4*i + 3];
+		}
+		double c[3][3] = {
+			{ a[1][1]*a[2][2] - a[1][2]*a[2][1], a[0][2]*a[2][1] - a[0][1]*a[2][2], a[0][1]*a[1][2] - a[0][2]*a[1][1] },
+			{ a[1][2]*a[2][0] - a[1][0]*a[2][2], a[0][0]*a[2][2] - a[0][2]*a[2][0], a[0][2]*a[1][0] - a[0][0]*a[1][2] },
+			{ a[1][0]*a[2][1] - a[1][1]*a[2][0], a[0][1]*a[2][0] - a[0][0]*a[2][1], a[0][0]*a[1][1] - a[0][1]*a[1][0] } };
+		double det = a[0][0]*c[0][0] + a[0][1]*c[1][0] + a[0][2]*c[2][0];
+		if (!(std::fabs(det) > 0) || !std::isfinite(det)) { return false; }
+
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				t.m[i][j]   = real(a[i][j]);
+				t.inv[i][j] = real(c[i][j] / det);
+			}
+			t.m[i][3] = real(b[i]);
+		}
+		for (int i = 0; i < 3; ++i) { // -M^-1 * t
+			t.inv[i][3] = real(-(c[i][0]*b[0] + c[i][1]*b[1] + c[i][2]*b[2]) / det);
+		}
+		return true;
+	}
+
+	/*
+	 *       ( 12 ) -     
+	 *  ,       .
+	*/
+	void to_matrices(double forward[12], double inverse[12]) const
+	{
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 4; ++j) { forward[4*i + j] = m[i][j]; inverse[4*i + j] = inv[i][j]; }
+		}
+	}
+
+	static transform from_matrices(const double forward[12], const double inverse[12])
+	{
+		transform t;
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 4; ++j) { t.m[i][j] = real(forward[4*i + j]); t.inv[i][j] = real(inverse[4*i + j]); }
+		}
+		return t;
+	}
+
+	/* :  b,  *this */
+	transform operator*(const transform& b) const
+	{
+		transform t;
+		multiply(m, b.m, t.m);
+		multiply(b.inv, inv, t.inv);
+		return t;
+	}
+
+	transform inverse() const
+	{
+		transform t = *this;
+		std::swap(t.m, t.inv);
+		return t;
+	}
+
+	point3 apply_point(const point3& p) const
+	{
+		return point3(m[0][0]*p.x() + m[0][1]*p.y() + m[0][2]*p.z() + m[0][3],
+					  m[1][0]*p.x() + m[1][1]*p.y() + m[1][2]*p.z() + m[1][3],
+					  m[2][0]*p.x() + m[2][1]*p.y() + m[2][2]*p.z() + m[2][3]);
+	}
+
+	vec3 apply_vector(const vec3& v) const
+	{
+		return vec3(m[0][0]*v.x() + m[0][1]*v.y() + m[0][2]*v.z(),
+					m[1][0]*v.x() + m[1][1]*v.y() + m[1][2]*v.z(),
+					m[2][0]*v.x() + m[2][1]*v.y() + m[2][2]*v.z());
+	}
+
+	/* : (M^-1)^T * n,   */
+	vec3 apply_normal(const vec3& n) const
+	{
+		return vec3(inv[0][0]*n.x() + inv[1][0]*n.y() + inv[2][0]*n.z(),
+					inv[0][1]*n.x() + inv[1][1]*n.y() + inv[2][1]*n.z(),
+					inv[0][2]*n.x() + inv[1][2]*n.y() + inv[2][2]*n.z());
+	}
+
+	/*
+	 *     .   , 
+	 *  t        .
+	*/
+	ray to_object(const ray& r) const
+	{
+		const point3& o = r.origin();
+		const vec3&   d = r.direction();
+		return ray(point3(inv[0][0]*o.x() + inv[0][1]*o.y() + inv[0][2]*o.z() + inv[0][3],
+						  inv[1][0]*o.x() + inv[1][1]*o.y() + inv[1][2]*o.z() + inv[1][3],
+						  inv[2][0]*o.x() + inv[2][1]*o.y() + inv[2][2]*o.z() + inv[2][3]),
+				   vec3(inv[0][0]*d.x() + inv[0][1]*d.y() + inv[0][2]*d.z(),
+						inv[1][0]*d.x() + inv[1][1]*d.y() + inv[1][2]*d.z(),
+						inv[2][0]*d.x() + inv[2][1]*d.y() + inv[2][2]*d.z()));
+	}
+
+	/*
+	 *      p ,  
+	 *  error:    |M|,  
+	 * M*p + t  .   :  
+	 *           .
+	*/
+	real point_error(const point3& p, real error) const
+	{
+		real bound = 0;
+		for (int i = 0; i < 3; ++i) {
+			real carried = (std::fabs(m[i][0]) + std::fabs(m[i][1]) + std::fabs(m[i][2])) * error;
+			real rounding = std::fabs(m[i][0] * p.x()) + std::fabs(m[i][1] * p.y()) + std::fabs(m[i][2] * p.z()) + std::fabs(m[i][3]);
+			bound = std::fmax(bound, carried + rounding_bound(6) * rounding);
+		}
+		return bound;
+	}
+
+	/*
+	 *    (Arvo, "Transforming Axis-
+	 * Aligned Bounding Boxes", 1990):      
+	 *     ,    .
+	*/
+	aabb apply(const aabb& box) const
+	{
+		if (box.x.size() < 0 || box.y.size() < 0 || box.z.size() < 0) { return box; }
+		interval out[3];
+		for (int i = 0; i < 3; ++i) {
+			real lo = m[i][3], hi = m[i][3];
+			for (int j = 0; j < 3; ++j) {
+				const interval& ax = box.axis_interval(j);
+				real a = m[i][j] * ax.min, b = m[i][j] * ax.max;
+				lo += std::fmin(a, b);
+				hi += std::fmax(a, b);
+			}
+			out[i] = interval(lo, hi);
+		}
+		return aabb(out[0], out[1], out[2]);
+	}
+};
+
+#endif
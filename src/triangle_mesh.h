@@ -0,0 +1,439 @@
+/***********************************************************************************
+*   triangle_mesh.h    triangle_mesh -
+*   ,    OBJ  PLY (. mesh_loader.h).
+*
+* /   /
+*  ,         
+*  positions, normals  uvs,   -     
+* indices.      ,  
+*  12    72   (double)   
+*   hittable      shared_ptr. 
+*   UV     (   OBJ),  
+*   normal_indices  uv_indices;   ,  
+*   indices.
+*
+* /  /
+*  (watertight)  Woop, Benthin, Wald ("Watertight Ray/Triangle
+* Intersection", 2013):       ( - 
+* ,  -  z),      
+*  .          
+*     ,  ,     
+* ,    ,     -. 
+*      float   double.
+*
+* /    /
+*     -   ,  
+*      (build()) - ,   flat_node
+* (flat_bvh.h):      ,  
+*  ,    SAH  .  -  
+*  ,   ,     
+*   .
+***********************************************************************************/
+
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "bvh.h"
+#include "flat_bvh.h"
+#include "hittable.h"
+
+/*    */
+struct mesh_uv
+{
+	real u = 0;
+	real v = 0;
+};
+
+class triangle_mesh : public hittable
+{
+public:
+	std::vector<point3>   positions;
+	std::vector<vec3>     normals;			//   ( -  )
+	std::vector<mesh_uv>  uvs;
+	std::vector<uint32_t> indices;			//     positions  
+	std::vector<uint32_t> normal_indices;	//   normals   (  indices)
+	std::vector<uint32_t> uv_indices;		//   uvs   (  indices)
+
+private:
+	typedef flat_node node;
+
+	static const int MAX_LEAF   = 4;	//    
+	static const int STACK_SIZE = flat_builder::STACK_SIZE;
+
+	/*           */
+	struct ray_frame : flat_ray
+	{
+		int    kx, ky, kz;	// kz -    
+		real   sx, sy, sz;	// ,     z
+
+		explicit ray_frame(const ray& r) : flat_ray(r)
+		{
+			const vec3& d = r.direction();
+			real ax = std::fabs(d.x()), ay = std::fabs(d.y()), az = std::fabs(d.z());
+			kz = (ax > ay) ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+			kx = (kz + 1) % 3;
+			ky = (kx + 1) % 3;
+			if (d[kz] < 0) { std::swap(kx, ky); } //   
+			sx = d[kx] / d[kz];
+			sy = d[ky] / d[kz];
+			sz = 1 / d[kz];
+		}
+	};
+
+	/*   : t     */
+	struct triangle_hit
+	{
+		real t  = 0;
+		real b0 = 0, b1 = 0, b2 = 0;
+	};
+
+	flat_node_array   nodes;
+	uint32_t          mat = 0;
+	aabb              bbox;
+	bvh_stats         build_info;
+
+	const point3& vertex(size_t triangle, int k) const { return positions[indices[3 * triangle + k]]; }
+
+	flat_ref make_ref(size_t triangle) const
+	{
+		const point3& p0 = vertex(triangle, 0);
+		const point3& p1 = vertex(triangle, 1);
+		const point3& p2 = vertex(triangle, 2);
+		flat_ref r;
+		for (int a = 0; a < 3; ++a) {
+			r.lo[a] = round_down_float(std::fmin(p0[a], std::fmin(p1[a], p2[a])));
+			r.hi[a] = round_up_float(std::fmax(p0[a], std::fmax(p1[a], p2[a])));
+		}
+		r.index = uint32_t(triangle);
+		return r;
+	}
+
+	/*
+	 *   ,  aabb::hit(),     1/dir 
+	 * :        
+	 *   (t0 == t1),     t1   t0.  
+	 *        ,     
+	 * ,  t1   2*gamma(3) (  pbrt).
+	*/
+	static bool box_hit(const node& n, const ray_frame& f, interval ray_t) { return flat_box_hit(n, f, ray_t); }
+
+	/*
+	 *  . e0, e1, e2 -  ,  
+	 * p0, p1, p2:   ,    , ..
+	 *   .  t ,   
+	 *     t (  pbrt-v3):  ""
+	 *       .
+	*/
+	bool intersect(size_t triangle, const ray_frame& f, const interval& ray_t, triangle_hit& h) const
+	{
+		RT_COUNT(primitive_tests, 1);
+		vec3 a = vertex(triangle, 0) - f.origin;
+		vec3 b = vertex(triangle, 1) - f.origin;
+		vec3 c = vertex(triangle, 2) - f.origin;
+
+		real ax = a[f.kx] - f.sx * a[f.kz], ay = a[f.ky] - f.sy * a[f.kz];
+		real bx = b[f.kx] - f.sx * b[f.kz], by = b[f.ky] - f.sy * b[f.kz];
+		real cx = c[f.kx] - f.sx * c[f.kz], cy = c[f.ky] - f.sy * c[f.kz];
+
+		real e0 = bx * cy - by * cx;
+		real e1 = cx * ay - cy * ax;
+		real e2 = ax * by - ay * bx;
+		if (std::is_same<real, float>::value && (e0 == 0 || e1 == 0 || e2 == 0)) {
+			e0 = real(double(bx) * cy - double(by) * cx);
+			e1 = real(double(cx) * ay - double(cy) * ax);
+			e2 = real(double(ax) * by - double(ay) * bx);
+		}
+		if ((e0 < 0 || e1 < 0 || e2 < 0) && (e0 > 0 || e1 > 0 || e2 > 0)) { return false; }
+		real det = e0 + e1 + e2;
+		if (det == 0) { return false; }
+
+		real az = f.sz * a[f.kz], bz = f.sz * b[f.kz], cz = f.sz * c[f.kz];
+		real inv_det = 1 / det;
+		real t = (e0 * az + e1 * bz + e2 * cz) * inv_det;
+		if (!ray_t.surrounds(t)) { return false; }
+
+		real max_x = std::fmax(std::fabs(ax), std::fmax(std::fabs(bx), std::fabs(cx)));
+		real max_y = std::fmax(std::fabs(ay), std::fmax(std::fabs(by), std::fabs(cy)));
+		real max_z = std::fmax(std::fabs(az), std::fmax(std::fabs(bz), std::fabs(cz)));
+		real max_e = std::fmax(std::fabs(e0), std::fmax(std::fabs(e1), std::fabs(e2)));
+		real delta_x = rounding_bound(5) * (max_x + max_z);
+		real delta_y = rounding_bound(5) * (max_y + max_z);
+		real delta_z = rounding_bound(3) * max_z;
+		real delta_e = 2 * (rounding_bound(2) * max_x * max_y + delta_y * max_x + delta_x * max_y);
+		real delta_t = 3 * (rounding_bound(3) * max_e * max_z + delta_e * max_z + delta_z * max_e) * std::fabs(inv_det);
+		if (t <= delta_t) { return false; }
+
+		h.t  = t;
+		h.b0 = e0 * inv_det;
+		h.b1 = e1 * inv_det;
+		h.b2 = e2 * inv_det;
+		return true;
+	}
+
+	/*
+	 *  rec   h  .   
+	 *  ,   r.at(t):     
+	 *     (pbrt: gamma(7) *  |b_i * p_i|). 
+	 *  ( )     ,
+	 *   ; .. spawn_ray()     rec.normal,
+	 *    ,    
+	 *   .
+	*/
+	void fill_record(const ray& r, size_t triangle, const triangle_hit& h, hit_record& rec) const
+	{
+		const point3& p0 = vertex(triangle, 0);
+		const point3& p1 = vertex(triangle, 1);
+		const point3& p2 = vertex(triangle, 2);
+
+		vec3 q0 = h.b0 * p0, q1 = h.b1 * p1, q2 = h.b2 * p2;
+		rec.p = q0 + q1 + q2;
+		rec.t = h.t;
+		rec.mat_id = mat;
+		real sum_x = std::fabs(q0.x()) + std::fabs(q1.x()) + std::fabs(q2.x());
+		real sum_y = std::fabs(q0.y()) + std::fabs(q1.y()) + std::fabs(q2.y());
+		real sum_z = std::fabs(q0.z()) + std::fabs(q1.z()) + std::fabs(q2.z());
+		rec.error = rounding_bound(7) * std::fmax(sum_x, std::fmax(sum_y, sum_z));
+
+		vec3 n = cross(p1 - p0, p2 - p0);
+		real area = n.length();
+		rec.set_face_normal(r, area > 0 ? n / area : -unitv(r.direction()));
+
+		if (!normals.empty()) {
+			const std::vector<uint32_t>& ni = normal_indices.empty() ? indices : normal_indices;
+			vec3 ns = h.b0 * normals[ni[3 * triangle]] + h.b1 * normals[ni[3 * triangle + 1]] + h.b2 * normals[ni[3 * triangle + 2]];
+			real length = ns.length();
+			if (length > 0) {
+				ns /= length;
+				real cos_theta = dot(ns, rec.normal);
+				if (cos_theta < 0) { ns = -ns; cos_theta = -cos_theta; }
+				auto l1 = [](const vec3& v) { return std::fabs(v.x()) + std::fabs(v.y()) + std::fabs(v.z()); };
+				rec.error *= l1(rec.normal) / (l1(ns) * std::fmax(cos_theta, real(1e-3)));
+				rec.normal = ns;
+			}
+		}
+
+		if (!uvs.empty()) {
+			const std::vector<uint32_t>& ti = uv_indices.empty() ? indices : uv_indices;
+			const mesh_uv& t0 = uvs[ti[3 * triangle]];
+			const mesh_uv& t1 = uvs[ti[3 * triangle + 1]];
+			const mesh_uv& t2 = uvs[ti[3 * triangle + 2]];
+			rec.u = h.b0 * t0.u + h.b1 * t1.u + h.b2 * t2.u;
+			rec.v = h.b0 * t0.v + h.b1 * t1.v + h.b2 * t2.v;
+		}
+		else {
+			rec.u = h.b1;
+			rec.v = h.b2;
+		}
+	}
+
+	/*    (,   UV)   refs */
+	static void permute(std::vector<uint32_t>& triangles, const std::vector<flat_ref>& refs)
+	{
+		if (triangles.empty()) { return; }
+		std::vector<uint32_t> sorted(triangles.size());
+		for (size_t k = 0; k < refs.size(); ++k) { std::copy_n(&triangles[3 * size_t(refs[k].index)], 3, &sorted[3 * k]); }
+		triangles.swap(sorted);
+	}
+
+	/*    a (nullptr -     v) */
+	void append_attribute(std::vector<uint32_t>& target, const uint32_t* v, const uint32_t* a)
+	{
+		if (target.empty()) {
+			if (!a || (a[0] == v[0] && a[1] == v[1] && a[2] == v[2])) { return; }
+			target = indices; //       
+		}
+		target.insert(target.end(), a ? a : v, (a ? a : v) + 3);
+	}
+
+public:
+	explicit triangle_mesh(uint32_t mat = 0) : mat(mat) {}
+
+	uint32_t get_material() const { return mat; }
+	void     set_material(uint32_t m) { mat = m; }
+
+	size_t triangle_count() const { return indices.size() / 3; }
+
+	/*     v; n  t -    UV (nullptr -  v) */
+	void add_triangle(const uint32_t v[3], const uint32_t* n = nullptr, const uint32_t* t = nullptr)
+	{
+		append_attribute(normal_indices, v, n);
+		append_attribute(uv_indices, v, t);
+		indices.insert(indices.end(), v, v + 3);
+	}
+
+	/*       */
+	size_t memory_bytes() const
+	{
+		return positions.capacity() * sizeof(point3) + normals.capacity() * sizeof(vec3) + uvs.capacity() * sizeof(mesh_uv)
+			+ (indices.capacity() + normal_indices.capacity() + uv_indices.capacity()) * sizeof(uint32_t)
+			+ nodes.capacity() * sizeof(node);
+	}
+
+	/*
+	 *  ;     ( mesh_loader.h
+	 *   ).     28   
+	 * (flat_ref)      .    ,
+	 *   (     ),   
+	 *      ,    
+	 *  .      - . flat_builder.
+	*/
+	void build(bvh_stats* stats = nullptr, bvh_build mode = bvh_build::sah, int threads = 0)
+	{
+		bvh_stats& s = build_info;
+		s = bvh_stats();
+		auto start = std::chrono::steady_clock::now();
+
+		nodes.clear();
+		size_t count = triangle_count();
+		if (count > 0) {
+			std::vector<flat_ref> refs(count);
+			for (size_t k = 0; k < count; ++k) { refs[k] = make_ref(k); }
+			flat_builder(nodes, MAX_LEAF, mode, threads).build(refs, s);
+			if (nodes.capacity() > nodes.size() + nodes.size() / 4) { nodes.shrink_to_fit(); }
+
+			permute(indices, refs);
+			permute(normal_indices, refs);
+			permute(uv_indices, refs);
+		}
+		bbox = nodes.empty() ? aabb() : aabb(interval(nodes[0].lo[0], nodes[0].hi[0]), interval(nodes[0].lo[1], nodes[0].hi[1]),
+											 interval(nodes[0].lo[2], nodes[0].hi[2]));
+
+		auto stop = std::chrono::steady_clock::now();
+		s.build_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+		if (stats) { *stats = s; }
+	}
+
+	/*
+	 *      positions ( 
+	 *  indices):  O(N)  ,     
+	 * (sah_cost  hierarchy_stats()).
+	*/
+	void refit(bvh_stats* stats = nullptr)
+	{
+		if (nodes.empty()) { return; }
+		auto start = std::chrono::steady_clock::now();
+		flat_builder::refit(nodes, [this](uint32_t k) { return make_ref(k); });
+		bbox = aabb(interval(nodes[0].lo[0], nodes[0].hi[0]), interval(nodes[0].lo[1], nodes[0].hi[1]), interval(nodes[0].lo[2], nodes[0].hi[2]));
+		build_info.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		build_info.sah_cost = flat_builder::sah_cost(nodes);
+		if (stats) { *stats = build_info; }
+	}
+
+	/*      */
+	const bvh_stats& hierarchy_stats() const { return build_info; }
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		if (nodes.empty()) { return false; }
+		ray_frame    f(r);
+		triangle_hit h, closest;
+		size_t       closest_triangle = 0;
+		bool         hit_anything = false;
+
+		uint32_t stack[STACK_SIZE];
+		int      top = 0;
+		uint32_t current = 0;
+		for (;;) {
+			RT_COUNT(node_tests, 1);
+			const node& n = nodes[current];
+			if (box_hit(n, f, ray_t)) {
+				if (n.count == 0) {
+					uint32_t near_child = current + 1, far_child = n.offset;
+					if (f.negative[n.axis]) { std::swap(near_child, far_child); }
+					stack[top++] = far_child;
+					current = near_child;
+					continue;
+				}
+				for (uint32_t k = n.offset; k < n.offset + n.count; ++k) {
+					if (intersect(k, f, ray_t, h)) {
+						closest = h;
+						closest_triangle = k;
+						hit_anything = true;
+						ray_t.max = h.t;
+					}
+				}
+			}
+			if (top == 0) { break; }
+			current = stack[--top];
+		}
+
+		if (hit_anything) { fill_record(r, closest_triangle, closest, rec); }
+		return hit_anything;
+	}
+
+	/*       */
+	bool occluded(const ray& r, interval ray_t) const override
+	{
+		if (nodes.empty()) { return false; }
+		ray_frame    f(r);
+		triangle_hit h;
+
+		uint32_t stack[STACK_SIZE];
+		int      top = 0;
+		uint32_t current = 0;
+		for (;;) {
+			RT_COUNT(node_tests, 1);
+			const node& n = nodes[current];
+			if (box_hit(n, f, ray_t)) {
+				if (n.count == 0) {
+					stack[top++] = n.offset;
+					current = current + 1;
+					continue;
+				}
+				for (uint32_t k = n.offset; k < n.offset + n.count; ++k) {
+					if (intersect(k, f, ray_t, h)) { return true; }
+				}
+			}
+			if (top == 0) { break; }
+			current = stack[--top];
+		}
+		return false;
+	}
+
+	aabb bounding_box() const override { return bbox; }
+
+	/*
+	 *   rings   segments     UV  ( 
+	 *    ),  2*rings*segments .
+	*/
+	static triangle_mesh uv_sphere(const point3& center, real radius, int rings, int segments, uint32_t mat)
+	{
+		triangle_mesh mesh(mat);
+		size_t columns = size_t(segments) + 1;
+		mesh.positions.reserve(size_t(rings + 1) * columns);
+		mesh.normals.reserve(size_t(rings + 1) * columns);
+		mesh.uvs.reserve(size_t(rings + 1) * columns);
+		for (int i = 0; i <= rings; ++i) {
+			double theta = PI * i / rings;
+			for (int j = 0; j <= segments; ++j) {
+				double phi = 2 * PI * (j % segments) / segments; // :   ,   j = 0
+				vec3 n(real(std::sin(theta) * std::cos(phi)), real(std::cos(theta)), real(std::sin(theta) * std::sin(phi)));
+				mesh.positions.push_back(center + radius * n);
+				mesh.normals.push_back(n);
+				mesh.uvs.push_back({ real(double(j) / segments), real(1 - double(i) / rings) });
+			}
+		}
+
+		mesh.indices.reserve(size_t(6) * rings * segments);
+		for (int i = 0; i < rings; ++i) {
+			for (int j = 0; j < segments; ++j) {
+				uint32_t a = uint32_t(i * columns + j), b = a + 1;
+				uint32_t c = uint32_t(a + columns), d = c + 1;
+				//       
+				if (i > 0)         { uint32_t t[3] = { a, b, c }; mesh.add_triangle(t); }
+				if (i < rings - 1) { uint32_t t[3] = { b, d, c }; mesh.add_triangle(t); }
+			}
+		}
+		mesh.build();
+		return mesh;
+	}
+};
+
+#endif
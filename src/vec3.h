@@ -31,37 +31,45 @@
 * 
 *     : unitv().
 * 
-*  : random_unit_vector()  random_on_hemisphere()  
-*          
-*  ,       
-*  .
-* 
-* >   --  .
+*     (random_unit_vector(), random_on_hemisphere(),
+* random_in_unit_disk())   sampling.h.
 * 
 *     inline -  .
+*
+*  basic_vec3<T>     -     T; vec3 - 
+* basic_vec3<real>,  real -     (. rt_settings.h).
+*    (t * v, v / t, ...)      
+*    T,    0.5 * v    float.
+*
+*    RT_SIMD_VEC3 basic_vec3  float  double  
+*      (. vec3_simd.h).
 ***********************************************************************************/
 
+
 #ifndef VEC3_H
 #define VEC3_H
 
-class vec3
+template <typename T, typename Enable = void>
+class basic_vec3
 {																					
 public:
-	double e[3];
+	using value_type = T;
+
+	T e[3];
 
-	vec3() : e {0,0,0} {}
-	vec3(double e0, double e1, double e2) : e{e0, e1, e2} {}
+	basic_vec3() : e {0,0,0} {}
+	basic_vec3(T e0, T e1, T e2) : e{e0, e1, e2} {}
 
-	double x() const { return e[0]; }
-	double y() const { return e[1]; }
-	double z() const { return e[2]; }
+	T x() const { return e[0]; }
+	T y() const { return e[1]; }
+	T z() const { return e[2]; }
 
-	vec3 operator-() const { return vec3(-e[0], -e[1], -e[2]); }
+	basic_vec3 operator-() const { return basic_vec3(-e[0], -e[1], -e[2]); }
 
-	double  operator[](int i) const { return e[i]; }
-	double& operator[](int i) { return e[i]; }
+	T  operator[](int i) const { return e[i]; }
+	T& operator[](int i) { return e[i]; }
 
-	vec3& operator+=(const vec3& v)
+	basic_vec3& operator+=(const basic_vec3& v)
 	{
 		e[0] += v.e[0];
 		e[1] += v.e[1];
@@ -69,7 +77,7 @@ public:
 		return *this;
 	}
 
-	vec3& operator*=(double t)
+	basic_vec3& operator*=(T t)
 	{
 		e[0] *= t;
 		e[1] *= t;
@@ -77,53 +85,74 @@ public:
 		return *this;
 	}
 
-	vec3& operator/=(double t) { return *this *= 1 / t; }
+	basic_vec3& operator/=(T t) { return *this *= 1 / t; }
 	
 	/* magnitude */
-	double length() const { return std::sqrt(length_squared()); }
+	T length() const { return std::sqrt(length_squared()); }
 	
-	double length_squared() const { return e[0]*e[0] + e[1]*e[1] + e[2]*e[2]; }
-
-	static vec3 random() { return vec3(random_double(), random_double(), random_double()); }
-	static vec3 random(double min, double max) { return vec3(random_double(min, max), random_double(min, max), random_double(min, max)); }
+	T length_squared() const { return e[0]*e[0] + e[1]*e[1] + e[2]*e[2]; }
+
+	//     :    
+	//  ,      .
+	static basic_vec3 random(rng& gen) 
+	{ 
+		T x = T(random_double(gen));
+		T y = T(random_double(gen));
+		T z = T(random_double(gen));
+		return basic_vec3(x, y, z); 
+	}
+	static basic_vec3 random(rng& gen, double min, double max) 
+	{ 
+		T x = T(random_double(gen, min, max));
+		T y = T(random_double(gen, min, max));
+		T z = T(random_double(gen, min, max));
+		return basic_vec3(x, y, z); 
+	}
 
 	bool near_zero() const
 	{
-		double s = 1e-8; // 0.0000001
+		T s = T(1e-8); // 0.0000001
 		return(std::fabs(e[0]) < s) && (std::fabs(e[1]) < s) && (std::fabs(e[2]) <s );
 	}
 
 };
 
+#include "vec3_simd.h"
+
+using vec3   = basic_vec3<real>;
 using point3 = vec3;
 
 /* print */
-inline std::ostream& operator<<(std::ostream& out, const vec3& v) {
+template <typename T>
+inline std::ostream& operator<<(std::ostream& out, const basic_vec3<T>& v) {
 	return out << v.e[0] << ' ' << v.e[1] << ' ' << v.e[2];
 }
 
 /*   */
-inline vec3 operator+(const vec3& u, const vec3& v) 
+template <typename T>
+inline basic_vec3<T> operator+(const basic_vec3<T>& u, const basic_vec3<T>& v) 
 {
-	return vec3(
+	return basic_vec3<T>(
 		u.e[0] + v.e[0],
 		u.e[1] + v.e[1],
 		u.e[2] + v.e[2]
 	);
 }
 
-inline vec3 operator-(const vec3& u, const vec3& v)
+template <typename T>
+inline basic_vec3<T> operator-(const basic_vec3<T>& u, const basic_vec3<T>& v)
 {
-	return vec3(
+	return basic_vec3<T>(
 		u.e[0] - v.e[0],
 		u.e[1] - v.e[1],	
 		u.e[2] - v.e[2]
 	);
 }
 
-inline vec3 operator*(const vec3& u, const vec3& v)
+template <typename T>
+inline basic_vec3<T> operator*(const basic_vec3<T>& u, const basic_vec3<T>& v)
 {
-	return vec3(
+	return basic_vec3<T>(
 		u.e[0] * v.e[0],
 		u.e[1] * v.e[1],
 		u.e[2] * v.e[2]
@@ -131,57 +160,42 @@ inline vec3 operator*(const vec3& u, const vec3& v)
 }
 
 /*   */
-inline vec3 operator*(double t, const vec3& v)
+template <typename T>
+inline basic_vec3<T> operator*(typename basic_vec3<T>::value_type t, const basic_vec3<T>& v)
 {
-	return vec3(
+	return basic_vec3<T>(
 		t*v.e[0],
 		t*v.e[1],
 		t*v.e[2]
 	);
 }
 
-inline vec3 operator*(const vec3& v, double t) { return t * v; }
+template <typename T>
+inline basic_vec3<T> operator*(const basic_vec3<T>& v, typename basic_vec3<T>::value_type t) { return t * v; }
 
-inline vec3 operator/(const vec3& v, double t) { return (1/t) * v; }
+template <typename T>
+inline basic_vec3<T> operator/(const basic_vec3<T>& v, typename basic_vec3<T>::value_type t) { return (1/t) * v; }
 
 /*      ..: dot(), cross() */
-inline double dot(const vec3& u, const vec3& v)
+template <typename T>
+inline T dot(const basic_vec3<T>& u, const basic_vec3<T>& v)
 {
 	return u.e[0] * v.e[0]
 		+  u.e[1] * v.e[1]
 		+  u.e[2] * v.e[2];
 }
 
-inline vec3 cross(const vec3& u, const vec3& v)
+template <typename T>
+inline basic_vec3<T> cross(const basic_vec3<T>& u, const basic_vec3<T>& v)
 {
-	return vec3(u.e[1] * v.e[2] - u.e[2] * v.e[1],
-				u.e[2] * v.e[0] - u.e[0] * v.e[2],
-				u.e[0] * v.e[1] - u.e[1] * v.e[0]);
+	return basic_vec3<T>(u.e[1] * v.e[2] - u.e[2] * v.e[1],
+						 u.e[2] * v.e[0] - u.e[0] * v.e[2],
+						 u.e[0] * v.e[1] - u.e[1] * v.e[0]);
 }
 
 /*     -  */
-inline vec3 unitv(const vec3& v) { return v/v.length(); } 
-
-/* Random method by reflection */
-inline vec3 random_unit_vector()
-{
-	for (;;) {
-		vec3 p = vec3::random(-1,1);                                 //       
-		double lensq = p.length_squared();
-		if (1e-160 < lensq && lensq <= 1) { return p/sqrt(lensq); }  //     
-																	 // 10^-160      ,
-																	 //      .
-	}
-}
-
-inline vec3 random_on_hemisphere(const vec3& normal)
-{
-	vec3 rndv_in_unit_sp = random_unit_vector();
-	if (dot(rndv_in_unit_sp, normal) > 0.0) { return rndv_in_unit_sp; } //       
-																		// ,     
-																		//     
-	else { return -rndv_in_unit_sp; }
-}
+template <typename T>
+inline basic_vec3<T> unitv(const basic_vec3<T>& v) { return v/v.length(); } 
 
 /* 
  *  reflect      v   
@@ -205,9 +219,9 @@ inline vec3 reflect(const vec3& v, const vec3& n) { return v - 2*dot(v,n)*n; }
  *  .      ,   
  *     ( )     .
 */
-inline vec3 refract(const vec3& uv, const vec3& n, double etai_over_etat)
+inline vec3 refract(const vec3& uv, const vec3& n, real etai_over_etat)
 {
-	double cos_theta = std::fmin(dot(-uv, n), 1.0);				// ..   uv ,   
+	real cos_theta = std::fmin(dot(-uv, n), real(1));				// ..   uv ,   
 																//    .
 
 	vec3 r_out_perp = etai_over_etat * (uv + cos_theta * n);	//         
@@ -216,16 +230,8 @@ inline vec3 refract(const vec3& uv, const vec3& n, double etai_over_etat)
 																//       -
 																//  .
 
-	vec3 r_out_paral = -std::sqrt(std::fabs(1.0 - r_out_perp.length_squared()))*n; //  .
+	vec3 r_out_paral = -std::sqrt(std::fabs(1 - r_out_perp.length_squared()))*n; //  .
 	return r_out_perp + r_out_paral; 
 }
 
-inline vec3 random_in_unit_disk()
-{
-	for(;;) {
-		vec3 p = vec3(random_double(-1,1), random_double(-1,1), 0);
-		if (p.length_squared() < 1) { return p; }
-	}
-}
-
 #endif
\ No newline at end of file
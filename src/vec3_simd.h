@@ -0,0 +1,192 @@
+/***********************************************************************************
+*   vec3_simd.h    basic_vec3 
+*   RT_SIMD_VEC3 ( CMake RT_SIMD_VEC3).
+*
+*   basic_vec3   -     
+*    (24   double),      .
+*     ()     
+* : float - 16 ,  SSE (__m128); double - 32 ,  AVX
+* (__m256d). , ,     
+* -    .
+*
+*       (x(), e[], length(), dot(),
+* cross(), unitv(), ...),       
+*      vec3.h.
+*
+*    :
+* > unitv()  float       
+*   ( rsqrtss    )    length(), 
+*    -    ;  double  ;
+* > sizeof(vec3)  double   24  32 .
+*
+*    dot()  length_squared()  ,    :
+* (x + y) + z.    double  AVX2 (  -mavx2 
+* /arch:AVX2,    CMake);     .
+***********************************************************************************/
+
+#ifndef VEC3_SIMD_H
+#define VEC3_SIMD_H
+
+#include <type_traits>
+
+#if defined(RT_SIMD_VEC3) && (defined(__SSE2__) || defined(_M_X64) || defined(__AVX2__))
+	#include <immintrin.h>
+#endif
+
+/*
+ * vec3_lanes<T> -     4   T: (x, y, z, 0).
+ * enabled == false ,   T    basic_vec3.
+*/
+template <typename T>
+struct vec3_lanes { static const bool enabled = false; };
+
+#if defined(RT_SIMD_VEC3) && (defined(__SSE2__) || defined(_M_X64))
+template <>
+struct vec3_lanes<float>
+{
+	static const bool enabled = true;
+	using reg = __m128;
+
+	static reg set(float x, float y, float z) { return _mm_set_ps(0.0f, z, y, x); }
+	static reg set1(float t)   { return _mm_set1_ps(t); }
+	static reg zero()          { return _mm_setzero_ps(); }
+	static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+	static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+	static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+	static reg neg(reg a)      { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+	static reg abs(reg a)      { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static int less_mask(reg a, reg b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+
+	/*    cross(): (y, z, x)  (z, x, y) */
+	static reg yzx(reg a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)); }
+	static reg zxy(reg a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2)); }
+
+	/* (p.x + p.y) + p.z */
+	static float sum3(reg p)
+	{
+		__m128 s = _mm_add_ss(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 2, 1, 1)));
+		return _mm_cvtss_f32(_mm_add_ss(s, _mm_movehl_ps(p, p)));
+	}
+
+	/* 1/sqrt(s): 12  rsqrtss     r' = r*(1.5 - 0.5*s*r*r) */
+	static float rsqrt(float s)
+	{
+		__m128 v = _mm_set_ss(s);
+		__m128 r = _mm_rsqrt_ss(v);
+		__m128 h = _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), v), _mm_mul_ss(r, r));
+		return _mm_cvtss_f32(_mm_mul_ss(r, _mm_sub_ss(_mm_set_ss(1.5f), h)));
+	}
+};
+#endif
+
+#if defined(RT_SIMD_VEC3) && defined(__AVX2__)
+template <>
+struct vec3_lanes<double>
+{
+	static const bool enabled = true;
+	using reg = __m256d;
+
+	static reg set(double x, double y, double z) { return _mm256_set_pd(0.0, z, y, x); }
+	static reg set1(double t)  { return _mm256_set1_pd(t); }
+	static reg zero()          { return _mm256_setzero_pd(); }
+	static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+	static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+	static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+	static reg neg(reg a)      { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+	static reg abs(reg a)      { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+	static int less_mask(reg a, reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LT_OQ)); }
+
+	static reg yzx(reg a) { return _mm256_permute4x64_pd(a, _MM_SHUFFLE(3, 0, 2, 1)); }
+	static reg zxy(reg a) { return _mm256_permute4x64_pd(a, _MM_SHUFFLE(3, 1, 0, 2)); }
+
+	static double sum3(reg p)
+	{
+		__m128d lo = _mm256_castpd256_pd128(p);
+		__m128d s  = _mm_add_sd(lo, _mm_unpackhi_pd(lo, lo));
+		return _mm_cvtsd_f64(_mm_add_sd(s, _mm256_extractf128_pd(p, 1)));
+	}
+
+	/*
+	 *  AVX2  rsqrt  double,  rsqrtss     (12 -> 24 -> 48 )
+	 *   sqrtsd   (bench_vec3_ops()),   .
+	*/
+	static double rsqrt(double s) { return 1 / std::sqrt(s); }
+};
+#endif
+
+template <typename T>
+class basic_vec3<T, std::enable_if_t<vec3_lanes<T>::enabled>>
+{
+private:
+	using lanes = vec3_lanes<T>;
+	using reg   = typename lanes::reg;
+
+	explicit basic_vec3(reg v) : v(v) {}
+public:
+	using value_type = T;
+
+	union
+	{
+		reg v;
+		T   e[4];	// e[3]  0
+	};
+
+	basic_vec3() : v(lanes::zero()) {}
+	basic_vec3(T e0, T e1, T e2) : v(lanes::set(e0, e1, e2)) {}
+
+	T x() const { return e[0]; }
+	T y() const { return e[1]; }
+	T z() const { return e[2]; }
+
+	basic_vec3 operator-() const { return basic_vec3(lanes::neg(v)); }
+
+	T  operator[](int i) const { return e[i]; }
+	T& operator[](int i) { return e[i]; }
+
+	basic_vec3& operator+=(const basic_vec3& u) { v = lanes::add(v, u.v); return *this; }
+	basic_vec3& operator*=(T t) { v = lanes::mul(v, lanes::set1(t)); return *this; }
+	basic_vec3& operator/=(T t) { return *this *= 1 / t; }
+
+	T length() const { return std::sqrt(length_squared()); }
+	T length_squared() const { return lanes::sum3(lanes::mul(v, v)); }
+
+	static basic_vec3 random(rng& gen)
+	{
+		T x = T(random_double(gen));
+		T y = T(random_double(gen));
+		T z = T(random_double(gen));
+		return basic_vec3(x, y, z);
+	}
+	static basic_vec3 random(rng& gen, double min, double max)
+	{
+		T x = T(random_double(gen, min, max));
+		T y = T(random_double(gen, min, max));
+		T z = T(random_double(gen, min, max));
+		return basic_vec3(x, y, z);
+	}
+
+	bool near_zero() const
+	{
+		//    0    
+		return lanes::less_mask(lanes::abs(v), lanes::set1(T(1e-8))) == 0xf;
+	}
+
+	friend basic_vec3 operator+(const basic_vec3& a, const basic_vec3& b) { return basic_vec3(lanes::add(a.v, b.v)); }
+	friend basic_vec3 operator-(const basic_vec3& a, const basic_vec3& b) { return basic_vec3(lanes::sub(a.v, b.v)); }
+	friend basic_vec3 operator*(const basic_vec3& a, const basic_vec3& b) { return basic_vec3(lanes::mul(a.v, b.v)); }
+	friend basic_vec3 operator*(T t, const basic_vec3& a) { return basic_vec3(lanes::mul(lanes::set1(t), a.v)); }
+	friend basic_vec3 operator*(const basic_vec3& a, T t) { return t * a; }
+	friend basic_vec3 operator/(const basic_vec3& a, T t) { return (1/t) * a; }
+
+	friend T dot(const basic_vec3& a, const basic_vec3& b) { return lanes::sum3(lanes::mul(a.v, b.v)); }
+
+	friend basic_vec3 cross(const basic_vec3& a, const basic_vec3& b)
+	{
+		return basic_vec3(lanes::sub(lanes::mul(lanes::yzx(a.v), lanes::zxy(b.v)),
+									 lanes::mul(lanes::zxy(a.v), lanes::yzx(b.v))));
+	}
+
+	friend basic_vec3 unitv(const basic_vec3& a) { return lanes::rsqrt(a.length_squared()) * a; }
+};
+
+#endif
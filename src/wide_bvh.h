@@ -0,0 +1,419 @@
+/***********************************************************************************
+*   wide_bvh.h    wide_bvh:   
+* WIDTH = 4 ,        
+* ( 4 float     ),     
+*   (AVX2: float   4  double),   
+*   .
+*
+*      (flat_bvh.h) "":  
+*   ,     ,    
+* ,       ,     .
+*     (SAH  LBVH)     
+* ,   flat_bvh; refit()    .  
+*  ,    flat_bvh,   sphere_soa (leaf_objects).
+*
+* /  /
+*          tnear.
+*         ,  
+*  ,      ,  
+* tnear    .    ,  
+* flat_box_hit(),  double,        .
+***********************************************************************************/
+
+#ifndef WIDE_BVH_H
+#define WIDE_BVH_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "flat_bvh.h"
+#include "simd.h"
+
+/*    - 128  */
+struct alignas(64) wide_node
+{
+	float    lo[3][4];	//      ( : +INF)
+	float    hi[3][4];	//   ( : -INF)
+	uint32_t child[4];	//   -  ,  -  
+	uint8_t  count[4];	//   , 0 -  
+	uint8_t  size;		//  
+	uint8_t  spheres;	//  -    (leaf_objects)
+};
+static_assert(sizeof(wide_node) == 128, "wide BVH node must stay two cache lines");
+
+class wide_bvh : public hittable
+{
+public:
+	static const int WIDTH      = 4;
+	static const int STACK_SIZE = (WIDTH - 1) * flat_builder::MAX_DEPTH + WIDTH;
+
+	explicit wide_bvh(const hittable_list& list, bvh_stats* stats = nullptr, bvh_build mode = bvh_build::sah, int threads = 0)
+		: level(detect_simd_level())
+	{
+		auto start = std::chrono::steady_clock::now();
+		flat_node_array binary;
+		bvh_stats       binary_info;
+		flat_bvh::build_hierarchy(list, binary, leaves, binary_info, mode, threads);
+		if (!binary.empty()) {
+			nodes.reserve(binary.size() / 3 + 1);
+			collapse(binary, 0, 1);
+			bbox = flat_bvh::node_box(binary[0]);
+		}
+		build_info.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		build_info.sah_cost = sah_cost();
+		if (stats) { *stats = build_info; }
+	}
+
+	/*       (  ) */
+	void refit(bvh_stats* stats = nullptr)
+	{
+		if (nodes.empty()) { return; }
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = nodes.size(); i-- > 0;) { //      
+			wide_node& n = nodes[i];
+			for (int k = 0; k < n.size; ++k) {
+				flat_bounds b;
+				if (n.count[k] > 0) {
+					for (uint32_t j = n.child[k]; j < n.child[k] + n.count[k]; ++j) {
+						flat_ref r = make_flat_ref(leaves.objects[j]->bounding_box(), j);
+						b.grow(r.lo, r.hi);
+					}
+				}
+				else { b = node_bounds(nodes[n.child[k]]); }
+				for (int a = 0; a < 3; ++a) { n.lo[a][k] = b.lo[a]; n.hi[a][k] = b.hi[a]; }
+			}
+		}
+		leaves.gather_spheres();
+		flat_bounds root = node_bounds(nodes[0]);
+		bbox = aabb(interval(root.lo[0], root.hi[0]), interval(root.lo[1], root.hi[1]), interval(root.lo[2], root.hi[2]));
+		build_info.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		build_info.sah_cost = sah_cost();
+		if (stats) { *stats = build_info; }
+	}
+
+	simd_level get_simd_level() const { return level; }
+	void       set_simd_level(simd_level l) { level = (l <= detect_simd_level()) ? l : detect_simd_level(); }
+
+	const bvh_stats& hierarchy_stats() const { return build_info; }
+	size_t memory_bytes() const { return nodes.capacity() * sizeof(wide_node) + leaves.memory_bytes(); }
+
+	bool hit(const ray& r, interval ray_t, hit_record& rec) const override
+	{
+		if (nodes.empty()) { return false; }
+		frame f(r);
+		entry stack[STACK_SIZE];
+		int   top = 0;
+		bool  hit_anything = false;
+		stack[top++] = { 0, 0, false, ray_t.min };
+
+		while (top > 0) {
+			entry e = stack[--top];
+			if (e.tnear > ray_t.max) { continue; } //    
+			if (e.count > 0) {
+				if (leaves.hit(r, ray_t, rec, e.index, e.count, e.spheres)) {
+					hit_anything = true;
+					ray_t.max = rec.t;
+				}
+				continue;
+			}
+
+			RT_COUNT(node_tests, 1);
+			const wide_node& n = nodes[e.index];
+			double tnear[WIDTH];
+			int    mask = child_hits(n, f, ray_t, tnear);
+
+			//     tnear:     
+			int order[WIDTH], found = 0;
+			for (int k = 0; k < n.size; ++k) {
+				if (!(mask & (1 << k))) { continue; }
+				int j = found++;
+				for (; j > 0 && tnear[order[j - 1]] < tnear[k]; --j) { order[j] = order[j - 1]; }
+				order[j] = k;
+			}
+			for (int j = 0; j < found; ++j) {
+				int k = order[j];
+				stack[top++] = { n.child[k], n.count[k], bool(n.spheres & (1 << k)), tnear[k] };
+			}
+		}
+		return hit_anything;
+	}
+
+	/*    :     ,   */
+	bool occluded(const ray& r, interval ray_t) const override
+	{
+		if (nodes.empty()) { return false; }
+		frame    f(r);
+		uint32_t stack[STACK_SIZE];
+		int      top = 0;
+		stack[top++] = 0;
+
+		while (top > 0) {
+			RT_COUNT(node_tests, 1);
+			const wide_node& n = nodes[stack[--top]];
+			double tnear[WIDTH];
+			int    mask = child_hits(n, f, ray_t, tnear);
+			for (int k = 0; k < n.size; ++k) {
+				if (!(mask & (1 << k))) { continue; }
+				if (n.count[k] == 0) { stack[top++] = n.child[k]; continue; }
+				if (leaves.occluded(r, ray_t, n.child[k], n.count[k], (n.spheres & (1 << k)) != 0)) { return true; }
+			}
+		}
+		return false;
+	}
+
+	/*
+	 *     :   - ,   ,
+	 *   ,      . , 
+	 *    ,     ; 
+	 *       .
+	*/
+	void hit_packet(const ray* rays, const int* active, int count, interval ray_t,
+		hit_record* recs, bool* hits) const override
+	{
+		if (nodes.empty() || count <= 0) { return; }
+		if (count == 1) {
+			int k = active[0];
+			if (hit(rays[k], interval(ray_t.min, hits[k] ? recs[k].t : ray_t.max), recs[k])) { hits[k] = true; }
+			return;
+		}
+
+		frame frames[MAX_PACKET_SIZE];
+		for (int m = 0; m < count; ++m) { frames[m] = frame(rays[active[m]]); }
+		packet_entry stack[STACK_SIZE];
+		int          top = 0;
+		stack[top++] = { 0, 0, false, packet_all(count), ray_t.min };
+
+		while (top > 0) {
+			packet_entry e    = stack[--top];
+			packet_mask  live = 0;
+			for (packet_mask rest = e.mask; rest != 0; rest &= rest - 1) {
+				int m = packet_first(rest), k = active[m];
+				if (!hits[k] || e.tnear <= recs[k].t) { live |= packet_mask(1) << m; }
+			}
+			if (live == 0) { continue; }
+
+			if (e.count > 0) {
+				for (packet_mask rest = live; rest != 0; rest &= rest - 1) {
+					int k = active[packet_first(rest)];
+					if (leaves.hit(rays[k], interval(ray_t.min, hits[k] ? recs[k].t : ray_t.max), recs[k], e.index, e.count, e.spheres)) { hits[k] = true; }
+				}
+				continue;
+			}
+
+			const wide_node& n = nodes[e.index];
+			packet_mask child_mask[WIDTH] = {};
+			double      child_near[WIDTH] = { INF, INF, INF, INF };
+			for (packet_mask rest = live; rest != 0; rest &= rest - 1) {
+				RT_COUNT(node_tests, 1);
+				int    m = packet_first(rest), k = active[m];
+				double tnear[WIDTH];
+				int    mask = child_hits(n, frames[m], interval(ray_t.min, hits[k] ? recs[k].t : ray_t.max), tnear);
+				for (int c = 0; c < n.size; ++c) {
+					if (!(mask & (1 << c))) { continue; }
+					child_mask[c] |= packet_mask(1) << m;
+					if (tnear[c] < child_near[c]) { child_near[c] = tnear[c]; }
+				}
+			}
+
+			int order[WIDTH], found = 0;
+			for (int c = 0; c < n.size; ++c) {
+				if (child_mask[c] == 0) { continue; }
+				int j = found++;
+				for (; j > 0 && child_near[order[j - 1]] < child_near[c]; --j) { order[j] = order[j - 1]; }
+				order[j] = c;
+			}
+			for (int j = 0; j < found; ++j) {
+				int c = order[j];
+				stack[top++] = { n.child[c], n.count[c], bool(n.spheres & (1 << c)), child_mask[c], child_near[c] };
+			}
+		}
+	}
+
+	aabb bounding_box() const override { return bbox; }
+
+private:
+	/*  :  (count == 0)       */
+	struct entry
+	{
+		uint32_t index;
+		uint32_t count;
+		bool     spheres;	//    
+		double   tnear;
+	};
+
+	/*    :        */
+	struct packet_entry
+	{
+		uint32_t    index;
+		uint32_t    count;
+		bool        spheres;
+		packet_mask mask;
+		double      tnear;
+	};
+
+	/*   : , 1/dir     double */
+	struct frame
+	{
+		double origin[3];
+		double inv_dir[3];
+		bool   negative[3];
+
+		frame() = default;
+		explicit frame(const ray& r)
+		{
+			for (int a = 0; a < 3; ++a) {
+				origin[a]   = r.origin()[a];
+				inv_dir[a]  = 1 / double(r.direction()[a]);
+				negative[a] = r.direction()[a] < 0;
+			}
+		}
+	};
+
+	std::vector<wide_node, aligned_allocator<wide_node, 64>> nodes;
+	leaf_objects leaves;
+	aabb       bbox;
+	bvh_stats  build_info;
+	simd_level level;
+
+	/*   -    */
+	static flat_bounds node_bounds(const wide_node& n)
+	{
+		flat_bounds b;
+		for (int k = 0; k < n.size; ++k) {
+			float lo[3] = { n.lo[0][k], n.lo[1][k], n.lo[2][k] }, hi[3] = { n.hi[0][k], n.hi[1][k], n.hi[2][k] };
+			b.grow(lo, hi);
+		}
+		return b;
+	}
+
+	/*
+	 *  SAH   ( flat_builder::sah_cost()):  - 1 (
+	 *   ),  -  .
+	*/
+	double sah_cost() const
+	{
+		if (nodes.empty()) { return 0; }
+		double root = node_bounds(nodes[0]).area();
+		if (!(root > 0)) { return 0; }
+		double cost = 0;
+		for (const wide_node& n : nodes) {
+			cost += node_bounds(n).area();
+			for (int k = 0; k < n.size; ++k) {
+				if (n.count[k] == 0) { continue; }
+				flat_bounds b;
+				float lo[3] = { n.lo[0][k], n.lo[1][k], n.lo[2][k] }, hi[3] = { n.hi[0][k], n.hi[1][k], n.hi[2][k] };
+				b.grow(lo, hi);
+				cost += b.area() * n.count[k];
+			}
+		}
+		return cost / root;
+	}
+
+	/*
+	 *       b   (  ,
+	 *    -  )    .
+	*/
+	uint32_t collapse(const flat_node_array& binary, uint32_t b, int depth)
+	{
+		uint32_t index = uint32_t(nodes.size());
+		nodes.push_back(wide_node());
+		++build_info.nodes;
+		if (depth > build_info.max_depth) { build_info.max_depth = depth; }
+
+		uint32_t child[WIDTH];
+		int      size = 0;
+		if (binary[b].count > 0) { child[size++] = b; }
+		else { child[size++] = b + 1; child[size++] = binary[b].offset; }
+		while (size < WIDTH) { //      
+			int    best = -1;
+			double best_area = -1;
+			for (int k = 0; k < size; ++k) {
+				const flat_node& c = binary[child[k]];
+				if (c.count > 0) { continue; }
+				flat_bounds box;
+				box.grow(c.lo, c.hi);
+				if (box.area() > best_area) { best_area = box.area(); best = k; }
+			}
+			if (best < 0) { break; }
+			uint32_t c = child[best];
+			child[best]   = c + 1;
+			child[size++] = binary[c].offset;
+		}
+
+		uint32_t target[WIDTH];
+		for (int k = 0; k < size; ++k) {
+			const flat_node& c = binary[child[k]];
+			if (c.count > 0) { target[k] = c.offset; ++build_info.leaves; }
+			else { target[k] = collapse(binary, child[k], depth + 1); } // nodes  
+		}
+
+		wide_node& n = nodes[index];
+		for (int k = 0; k < WIDTH; ++k) {
+			for (int a = 0; a < 3; ++a) {
+				n.lo[a][k] = k < size ? binary[child[k]].lo[a] : float(INF);
+				n.hi[a][k] = k < size ? binary[child[k]].hi[a] : -float(INF);
+			}
+			n.child[k] = k < size ? target[k] : 0;
+			n.count[k] = k < size ? uint8_t(binary[child[k]].count) : 0;
+			if (k < size && binary[child[k]].count > 0 && binary[child[k]].axis != 0) { n.spheres |= uint8_t(1 << k); }
+		}
+		n.size = uint8_t(size);
+		return index;
+	}
+
+	/*  ,      ray_t,   tnear */
+	int child_hits(const wide_node& n, const frame& f, const interval& ray_t, double* tnear) const
+	{
+#ifdef RT_SIMD_X86
+		if (level != simd_level::scalar) { return child_hits_avx2(n, f, ray_t, tnear); }
+#endif
+		return child_hits_scalar(n, f, ray_t, tnear);
+	}
+
+	/*  flat_box_hit(),   ; NaN (0 * INF)    */
+	static int child_hits_scalar(const wide_node& n, const frame& f, const interval& ray_t, double* tnear)
+	{
+		const double grow = 1 + 2 * double(rounding_bound(3));
+		int mask = 0;
+		for (int k = 0; k < n.size; ++k) {
+			double lo = ray_t.min, hi = ray_t.max;
+			for (int a = 0; a < 3; ++a) {
+				double t0 = (double(n.lo[a][k]) - f.origin[a]) * f.inv_dir[a];
+				double t1 = (double(n.hi[a][k]) - f.origin[a]) * f.inv_dir[a];
+				if (f.negative[a]) { std::swap(t0, t1); }
+				t1 *= grow;
+				if (t0 > lo) { lo = t0; }
+				if (t1 < hi) { hi = t1; }
+			}
+			tnear[k] = lo;
+			if (lo <= hi) { mask |= 1 << k; }
+		}
+		return mask;
+	}
+
+#ifdef RT_SIMD_X86
+	/* max_pd(t0, lo)  min_pd(t1, hi)     NaN,      */
+	RT_TARGET_AVX2
+	static int child_hits_avx2(const wide_node& n, const frame& f, const interval& ray_t, double* tnear)
+	{
+		const __m256d grow = _mm256_set1_pd(1 + 2 * double(rounding_bound(3)));
+		__m256d lo = _mm256_set1_pd(ray_t.min);
+		__m256d hi = _mm256_set1_pd(ray_t.max);
+		for (int a = 0; a < 3; ++a) {
+			const __m256d o   = _mm256_set1_pd(f.origin[a]);
+			const __m256d inv = _mm256_set1_pd(f.inv_dir[a]);
+			__m256d t0 = _mm256_mul_pd(_mm256_sub_pd(_mm256_cvtps_pd(_mm_load_ps(n.lo[a])), o), inv);
+			__m256d t1 = _mm256_mul_pd(_mm256_sub_pd(_mm256_cvtps_pd(_mm_load_ps(n.hi[a])), o), inv);
+			if (f.negative[a]) { std::swap(t0, t1); }
+			t1 = _mm256_mul_pd(t1, grow);
+			lo = _mm256_max_pd(t0, lo);
+			hi = _mm256_min_pd(t1, hi);
+		}
+		_mm256_storeu_pd(tnear, lo);
+		return _mm256_movemask_pd(_mm256_cmp_pd(lo, hi, _CMP_LE_OQ)) & ((1 << n.size) - 1);
+	}
+#endif
+};
+
+#endif